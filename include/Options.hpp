@@ -16,6 +16,8 @@
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/variables_map.hpp>
+
+#include "converter_config.hpp"
     
 namespace po = boost::program_options;
 
@@ -50,6 +52,13 @@ struct options {
     void notify();
 };
 
+/*!
+ * \brief Build the configuration of the converter from the parsed options.
+ * \param vm The parsed options
+ * \return The configuration of the converter
+ */
+converter_config make_config(const po::variables_map& vm);
+
 } //end of namespace gooda
 
 #endif
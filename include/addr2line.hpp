@@ -0,0 +1,154 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file addr2line.hpp
+ * \brief Contains the management of the long-lived addr2line coprocesses.
+ */
+
+#ifndef GOODA_ADDR2LINE_HPP
+#define GOODA_ADDR2LINE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include "hash.hpp"
+#include "subprocess.hpp"
+
+namespace gooda {
+
+/*!
+ * \struct addr2line_frame
+ * \brief One frame of the inline stack reported by addr2line for an address.
+ */
+struct addr2line_frame {
+    std::string function;       //!< The name of the function
+    std::string location;       //!< The location in the "file:line (discriminator d)" form
+};
+
+/*!
+ * \typedef addr2line_callback
+ * \brief Functor receiving each queried address with its frames, the innermost frame first.
+ */
+typedef std::function<void(const std::string&, std::vector<addr2line_frame>&)> addr2line_callback;
+
+/*!
+ * \typedef address_iterator
+ * \brief An iterator on a list of addresses to resolve.
+ */
+typedef std::vector<std::string>::const_iterator address_iterator;
+
+/*!
+ * \class addr2line_process
+ * \brief An addr2line process bound to one executable, answering queries on its standard input.
+ *
+ * The process is started once with the flags "-f -a -i" and then reused for every query,
+ * so that the DWARF information of the executable is only loaded once.
+ */
+class addr2line_process {
+    public:
+        /*!
+         * \brief Start a new addr2line process for the given executable.
+         * \param addr2line The addr2line executable to use.
+         * \param executable The ELF file to query.
+         */
+        addr2line_process(const std::string& addr2line, const std::string& executable);
+
+        /*!
+         * \brief Resolve the addresses in the range [first, last).
+         *
+         * The addresses are streamed to the process while its answers are read back and the callback
+         * is called as soon as all the frames of an address are known, in the order of the addresses.
+         *
+         * \param first The first address to resolve.
+         * \param last The end of the range of addresses to resolve.
+         * \param callback The functor to call for each resolved address.
+         */
+        void query(address_iterator first, address_iterator last, const addr2line_callback& callback);
+
+        /*!
+         * \brief Indicates if the executable changed since the process has been started.
+         * \return true if the executable has been modified or replaced, false otherwise.
+         */
+        bool stale() const;
+
+    private:
+        std::string executable;     //!< The queried ELF file
+        time_t modification;        //!< The modification time of the executable at start
+        ino_t inode;                //!< The inode of the executable at start
+        subprocess process;         //!< The addr2line process
+};
+
+/*!
+ * \class addr2line_pool
+ * \brief A pool of addr2line processes, indexed by executable.
+ *
+ * The idle processes are kept between the queries, a pool kept between several conversions avoids
+ * loading the DWARF information of the same executables again. Several processes can be started for
+ * the same executable when it is queried concurrently.
+ *
+ * The number of idle processes is bounded by the capacity of the pool. Beyond it, the processes of the
+ * executables queried the least recently are terminated first, so that a long-lived pool does not keep
+ * the processes of the executables that are not converted anymore.
+ */
+class addr2line_pool {
+    public:
+        /*!
+         * \brief Create an empty pool.
+         * \param capacity The maximum number of idle processes, 0 for the number of cores.
+         */
+        explicit addr2line_pool(std::size_t capacity = 0);
+
+        /*!
+         * \brief Resolve the addresses in the range [first, last) with an idle process of the executable.
+         *
+         * If there is no idle process for the executable, a new one is started. If the executable changed
+         * since its processes were started, they are replaced. This function is thread-safe.
+         *
+         * \param addr2line The addr2line executable to use.
+         * \param executable The ELF file to query.
+         * \param first The first address to resolve.
+         * \param last The end of the range of addresses to resolve.
+         * \param callback The functor to call for each resolved address.
+         */
+        void query(const std::string& addr2line, const std::string& executable, address_iterator first, address_iterator last, const addr2line_callback& callback);
+
+        /*!
+         * \brief Return the number of idle processes of the given executable.
+         * \param addr2line The addr2line executable.
+         * \param executable The ELF file.
+         * \return The number of idle processes of the executable.
+         */
+        std::size_t idle_processes(const std::string& addr2line, const std::string& executable);
+
+    private:
+        /*!
+         * \struct executable_processes
+         * \brief The idle processes of one executable, never empty.
+         */
+        struct executable_processes {
+            std::vector<std::unique_ptr<addr2line_process>> processes;      //!< The idle processes
+            uint64_t last_use = 0;                                          //!< The time of the last query of the executable
+        };
+
+        std::mutex lock;                                                                            //!< Protect the idle processes
+        std::unordered_map<std::pair<std::string, std::string>, executable_processes> idle;        //!< The idle processes of each executable
+        std::size_t capacity;                                                                       //!< The maximum number of idle processes
+        std::size_t idle_count = 0;                                                                 //!< The number of idle processes
+        uint64_t clock = 0;                                                                         //!< The number of queries
+};
+
+}
+
+#endif
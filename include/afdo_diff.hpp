@@ -13,9 +13,8 @@
 #ifndef GOODA_AFDO_DIFF_HPP
 #define GOODA_AFDO_DIFF_HPP
 
-#include <boost/program_options/variables_map.hpp>
-
 #include "afdo_data.hpp"
+#include "converter_config.hpp"
 
 namespace gooda {
 
@@ -23,9 +22,9 @@ namespace gooda {
  * \brief Perform the diff two AFDO profiles.
  * \param first The first AFDO profile
  * \param second The second AFDO profile
- * \param vm The configuration, used to configure the printings
+ * \param config The configuration, used to configure the printings
  */
-void afdo_diff(const afdo_data& first, const afdo_data& second, boost::program_options::variables_map& vm);
+void afdo_diff(const afdo_data& first, const afdo_data& second, const converter_config& config);
 
 }
 
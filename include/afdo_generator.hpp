@@ -15,9 +15,9 @@
 
 #include <string>
 
-#include <boost/program_options/variables_map.hpp>
-
 #include "afdo_data.hpp"
+#include "gcov_file.hpp"
+#include "converter_config.hpp"
 
 namespace gooda {
 
@@ -25,9 +25,75 @@ namespace gooda {
  * \brief Generate the AFDO file corresponding to the given data. 
  * \param data The AFDO report. 
  * \param file The path to the file to write to. 
- * \param vm The options provided by the user. 
+ * \param config The options provided by the user. 
+ */
+void generate_afdo(const afdo_data& data, const std::string& file, const converter_config& config);
+
+/*!
+ * \class afdo_spool
+ * \brief The function section of an AFDO file, written one function at a time to a temporary file.
+ *
+ * The file name table precedes the functions in the AFDO file, but is only complete once all the
+ * functions are known. The functions are therefore spooled next to the output file and copied after
+ * the file name table when the profile is generated. The spool has a unique name, created with
+ * mkstemp, so that it never replaces an existing file and several conversions to the same output do
+ * not share it.
+ */
+class afdo_spool {
+    public:
+        /*!
+         * \brief Create the temporary file of the functions of the given AFDO file, in its directory.
+         * \param file The path to the AFDO file that will be generated.
+         * \param config The options provided by the user.
+         */
+        afdo_spool(const std::string& file, const converter_config& config);
+
+        /*!
+         * \brief Remove the temporary file.
+         */
+        ~afdo_spool();
+
+        /*!
+         * \brief Deleted copy constructor
+         * \param other The other spool
+         */
+        afdo_spool(const afdo_spool& other) = delete;
+
+        /*!
+         * \brief Deleted copy assignment operator
+         * \param other The other spool
+         * \return A reference to this
+         */
+        afdo_spool& operator=(const afdo_spool& other) = delete;
+
+        /*!
+         * \brief Append a function to the spool.
+         * \param data The AFDO profile whose file name table already contains the strings of the function.
+         * \param function The function to write.
+         */
+        void write(const afdo_data& data, const afdo_function& function);
+
+    private:
+        converter_config config;                        //!< The configuration
+        std::string file;                               //!< The path to the temporary file
+        gcov_file spool_file;                           //!< The temporary file
+        std::size_t count;                              //!< The number of spooled functions
+
+        friend void generate_afdo(const afdo_data& data, afdo_spool& spool, const std::string& file, const converter_config& config);
+};
+
+/*!
+ * \brief Generate the AFDO file from the given data and the functions of the spool.
+ *
+ * The functions of the data are ignored, its length of the function section must account for
+ * the spooled functions.
+ *
+ * \param data The AFDO report, without functions.
+ * \param spool The spooled functions.
+ * \param file The path to the file to write to.
+ * \param config The options provided by the user.
  */
-void generate_afdo(const afdo_data& data, const std::string& file, boost::program_options::variables_map& vm);
+void generate_afdo(const afdo_data& data, afdo_spool& spool, const std::string& file, const converter_config& config);
 
 }
 
@@ -15,33 +15,32 @@
 
 #include <string>
 
-#include <boost/program_options/variables_map.hpp>
-
 #include "afdo_data.hpp"
+#include "converter_config.hpp"
 
 namespace gooda {
 
 /*!
  * \brief Dump all the AFDO representation to the standard output. 
  * \param data The AFDO data. 
- * \param vm The user options.
+ * \param config The user options.
  */
-void dump_afdo(const afdo_data& data, boost::program_options::variables_map& vm);
+void dump_afdo(const afdo_data& data, const converter_config& config);
 
 /*!
  * \brief Dump the given afdo_stack to the standard output.
  * \param data The parent AFDO data. 
  * \param stack The inline stack to print
- * \param vm The user options.
+ * \param config The user options.
  */
-void dump_afdo(const afdo_data& data, const afdo_stack& stack, boost::program_options::variables_map& vm);
+void dump_afdo(const afdo_data& data, const afdo_stack& stack, const converter_config& config);
 
 /*!
  * \brief Dump a summary of the AFDO representation to the standard output. 
  * \param data The AFDO data. 
- * \param vm The user options.
+ * \param config The user options.
  */
-void dump_afdo_light(const afdo_data& data, boost::program_options::variables_map& vm);
+void dump_afdo_light(const afdo_data& data, const converter_config& config);
 
 }
 
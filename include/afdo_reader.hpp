@@ -15,9 +15,8 @@
 
 #include <string>
 
-#include <boost/program_options/variables_map.hpp>
-
 #include "afdo_data.hpp"
+#include "converter_config.hpp"
 
 namespace gooda {
 
@@ -25,9 +24,9 @@ namespace gooda {
  * \brief Read an AFDO file and populate an AFDO data structure with its data. 
  * \param afdo_file The path to the AFDO file. 
  * \param data The data to populate. 
- * \param vm The user configuration. 
+ * \param config The user configuration. 
  */
-void read_afdo(const std::string& afdo_file, gooda::afdo_data& data, boost::program_options::variables_map& vm);
+void read_afdo(const std::string& afdo_file, gooda::afdo_data& data, const converter_config& config);
 
 }
 
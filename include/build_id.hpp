@@ -0,0 +1,29 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file build_id.hpp
+ * \brief Contains the function to extract the GNU build-id of ELF files.
+ */
+
+#ifndef GOODA_BUILD_ID_HPP
+#define GOODA_BUILD_ID_HPP
+
+#include <string>
+
+namespace gooda {
+
+/*!
+ * \brief Return the GNU build-id (NT_GNU_BUILD_ID note) of the given ELF file.
+ * \param file The path to the ELF file.
+ * \return The build-id as an hexadecimal string, or an empty string if the file has no build-id.
+ */
+std::string build_id(const std::string& file);
+
+}
+
+#endif
@@ -14,20 +14,320 @@
 #ifndef GOODA_CONVERTER_HPP
 #define GOODA_CONVERTER_HPP
 
-#include <boost/program_options/variables_map.hpp>
+#include <memory>
+#include <map>
+#include <string>
+#include <vector>
 
 #include "afdo_data.hpp"
 #include "gooda_report.hpp"
+#include "converter_config.hpp"
 
 namespace gooda {
 
+/*!
+ * \struct converter_statistics
+ * \brief Statistics about the last conversion of a context
+ */
+struct converter_statistics {
+    std::size_t functions = 0;                  //!< The number of converted functions
+    std::size_t instructions = 0;               //!< The number of annotated instructions
+    std::size_t symbolized_addresses = 0;       //!< The number of addresses symbolized by the conversion
+    std::size_t shared_addresses = 0;           //!< The number of addresses found in the shared symbolization results
+    std::size_t missing_stacks = 0;             //!< The number of inlined instructions without inline stack
+};
+
+/*!
+ * \struct symbolization_results
+ * \brief The inline stacks and discriminators of the addresses of the converted executables.
+ */
+struct symbolization_results;
+
+class symbol_cache;
+
+class addr2line_pool;
+
+struct perf_profile;
+
+/*!
+ * \class converter_context
+ * \brief The state of the conversions, owning the symbolization results, the addr2line processes and the statistics.
+ *
+ * A context can be reused for several conversions, but is used by one conversion at a time. Independent
+ * conversions can run concurrently on different threads, each with its own context. The symbolization
+ * results of a context can be shared read-only with other contexts converting reports of the same executables,
+ * which then only symbolize the addresses missing from the shared results.
+ */
+class converter_context {
+    public:
+        /*!
+         * \brief Create an empty context.
+         */
+        converter_context();
+
+        /*!
+         * \brief Create a context reusing the given symbolization results.
+         * \param shared The results of another context, never modified by this context.
+         */
+        explicit converter_context(std::shared_ptr<const symbolization_results> shared);
+
+        /*!
+         * \brief Destroy the context and terminate its addr2line processes.
+         */
+        ~converter_context();
+
+        /*!
+         * \brief Deleted copy constructor
+         * \param other The other context
+         */
+        converter_context(const converter_context& other) = delete;
+
+        /*!
+         * \brief Deleted copy assignment operator
+         * \param other The other context
+         * \return A reference to this
+         */
+        converter_context& operator=(const converter_context& other) = delete;
+
+        /*!
+         * \brief Return the symbolization results of the last conversion, to share them with other contexts.
+         * \return The symbolization results of the last conversion.
+         */
+        std::shared_ptr<const symbolization_results> results() const;
+
+        /*!
+         * \brief Return the statistics of the last conversion.
+         * \return The statistics of the last conversion.
+         */
+        const converter_statistics& statistics() const;
+
+        /*!
+         * \brief Prepare the context for a new conversion.
+         *
+         * The symbolization results and the statistics are cleared. If the results are still shared
+         * with other contexts, new results are allocated instead.
+         */
+        void reset();
+
+        /*!
+         * \brief Return the addr2line processes of the context.
+         * \return The addr2line processes of the context.
+         */
+        addr2line_pool& pool();
+
+        /*!
+         * \brief Use the given addr2line processes instead of the ones of the context.
+         *
+         * The pool is thread-safe, the same pool can be used by several contexts concurrently, so that
+         * the number of idle processes is bounded for all of them.
+         *
+         * \param pool The addr2line processes.
+         */
+        void set_pool(std::shared_ptr<addr2line_pool> pool);
+
+        /*!
+         * \brief Return the symbolization results of the current conversion.
+         * \return The symbolization results of the current conversion.
+         */
+        symbolization_results& symbols();
+
+        /*!
+         * \brief Return the shared symbolization results.
+         * \return The shared symbolization results, nullptr if there are none.
+         */
+        const symbolization_results* shared_symbols() const;
+
+        /*!
+         * \brief Return the statistics of the current conversion.
+         * \return The statistics of the current conversion.
+         */
+        converter_statistics& statistics();
+
+        /*!
+         * \brief Set the symbol cache used by the conversions of the context, instead of the one of the configuration.
+         *
+         * A symbol cache kept between several conversions keeps the symbols of their executables in memory. The
+         * same cache can be used by several contexts concurrently.
+         *
+         * \param cache The symbol cache, nullptr to use the one of the configuration.
+         */
+        void set_symbol_cache(std::shared_ptr<symbol_cache> cache);
+
+        /*!
+         * \brief Return the symbol cache used by the conversions of the context.
+         * \return The symbol cache set on the context, nullptr if there is none.
+         */
+        std::shared_ptr<symbol_cache> get_symbol_cache() const;
+
+    private:
+        struct impl;
+
+        std::unique_ptr<impl> m_impl;                           //!< The state of the context
+};
+
 /*!
  * \brief Populate the AFDO data report from the Gooda report. 
  * \param report The Gooda report
  * \param data The AFDO data. 
- * \param vm The options provided by the user. 
+ * \param config The options provided by the user. 
+ */
+void convert_to_afdo(const gooda_report& report, afdo_data& data, const converter_config& config);
+
+/*!
+ * \brief Populate the AFDO data report from the Gooda report, using the given context.
+ *
+ * The addr2line processes of the context are reused by all the queries of the conversion and remain
+ * available for the next conversions using the same context.
+ *
+ * \param report The Gooda report
+ * \param data The AFDO data.
+ * \param config The options provided by the user.
+ * \param context The context of the conversion.
+ */
+void convert_to_afdo(const gooda_report& report, afdo_data& data, const converter_config& config, converter_context& context);
+
+/*!
+ * \brief Populate one AFDO profile for each process of the Gooda report.
+ * \param report The Gooda report
+ * \param profiles The AFDO profile of each process, indexed by process name.
+ * \param config The options provided by the user.
+ */
+void convert_to_afdo_by_process(const gooda_report& report, std::map<std::string, afdo_data>& profiles, const converter_config& config);
+
+/*!
+ * \brief Populate one AFDO profile for each process of the Gooda report, using the given context.
+ *
+ * The report is swept once and the functions of all the processes are symbolized and annotated
+ * together, then partitioned by the process column of the hotspot functions. --top and --coverage
+ * apply to each process.
+ *
+ * \param report The Gooda report
+ * \param profiles The AFDO profile of each process, indexed by process name.
+ * \param config The options provided by the user.
+ * \param context The context of the conversion.
+ */
+void convert_to_afdo_by_process(const gooda_report& report, std::map<std::string, afdo_data>& profiles, const converter_config& config, converter_context& context);
+
+/*!
+ * \brief Populate one AFDO profile for each executable file (module) of the Gooda report.
+ * \param report The Gooda report
+ * \param profiles The AFDO profile of each module, indexed by module name.
+ * \param config The options provided by the user.
+ */
+void convert_to_afdo_by_module(const gooda_report& report, std::map<std::string, afdo_data>& profiles, const converter_config& config);
+
+/*!
+ * \brief Populate one AFDO profile for each executable file (module) of the Gooda report, using the given context.
+ *
+ * The report is swept once and the functions of all the modules are symbolized and annotated together,
+ * then routed to the profile of their module, with its own string table and working set. The process
+ * filter applies, --top and --coverage apply to each module.
+ *
+ * \param report The Gooda report
+ * \param profiles The AFDO profile of each module, indexed by module name.
+ * \param config The options provided by the user.
+ * \param context The context of the conversion.
+ */
+void convert_to_afdo_by_module(const gooda_report& report, std::map<std::string, afdo_data>& profiles, const converter_config& config, converter_context& context);
+
+/*!
+ * \brief Populate a single AFDO profile from several Gooda reports of the same executables.
+ * \param reports The Gooda reports
+ * \param weights The weight of each report, empty to give the same weight to all the reports.
+ * \param data The AFDO data.
+ * \param config The options provided by the user.
+ */
+void aggregate_to_afdo(const std::vector<gooda_report>& reports, const std::vector<double>& weights, afdo_data& data, const converter_config& config);
+
+/*!
+ * \brief Populate a single AFDO profile from several Gooda reports of the same executables, using the given context.
+ *
+ * The addresses of all the reports are symbolized together, each address once per executable. The
+ * counts of each report are scaled by its weight, then the functions of the same executable with the
+ * same name are merged across the reports, summing the counts of their identical inline stacks.
+ *
+ * \param reports The Gooda reports
+ * \param weights The weight of each report, empty to give the same weight to all the reports.
+ * \param data The AFDO data.
+ * \param config The options provided by the user.
+ * \param context The context of the conversion.
+ */
+void aggregate_to_afdo(const std::vector<gooda_report>& reports, const std::vector<double>& weights, afdo_data& data, const converter_config& config, converter_context& context);
+
+
+/*!
+ * \brief Convert the Gooda spreadsheets to an AFDO file, one function at a time.
+ *
+ * The assembly view of each function is read, converted, written to the output and released
+ * before the next one, so that the memory used by the conversion is bounded by the largest
+ * function, the string table and the symbol tables of the executables. The profile is the same
+ * as the one generated from convert_to_afdo.
+ *
+ * \param directory The spreadsheets directory
+ * \param file The path to the AFDO file to generate
+ * \param config The configuration
+ */
+void stream_to_afdo(const std::string& directory, const std::string& file, const converter_config& config);
+
+/*!
+ * \brief Convert the Gooda spreadsheets to an AFDO file, one function at a time, within the given context.
+ * \param directory The spreadsheets directory
+ * \param file The path to the AFDO file to generate
+ * \param config The configuration
+ * \param context The context of the conversion
+ */
+void stream_to_afdo(const std::string& directory, const std::string& file, const converter_config& config, converter_context& context);
+
+/*!
+ * \brief Update a previous AFDO profile with the given Gooda report.
+ *
+ * The counts of the previous profile are scaled by the decay factor, then the functions converted
+ * from the report are merged with its functions. The functions of the report are kept apart like
+ * in a plain conversion. The previous profile does not record the executables, the nth function of
+ * a name in the previous profile is merged with the nth function of this name in the report. The
+ * working set is estimated from the stacks of the merged profile.
+ *
+ * \param report The Gooda report
+ * \param history The previous AFDO profile, its functions are moved into the data
+ * \param decay The factor applied to the counts of the previous profile
+ * \param data The AFDO profile to populate
+ * \param config The configuration
+ */
+void update_to_afdo(const gooda_report& report, afdo_data& history, double decay, afdo_data& data, const converter_config& config);
+
+/*!
+ * \brief Update a previous AFDO profile with the given Gooda report, within the given context.
+ * \param report The Gooda report
+ * \param history The previous AFDO profile, its functions are moved into the data
+ * \param decay The factor applied to the counts of the previous profile
+ * \param data The AFDO profile to populate
+ * \param config The configuration
+ * \param context The context of the conversion
+ */
+void update_to_afdo(const gooda_report& report, afdo_data& history, double decay, afdo_data& data, const converter_config& config, converter_context& context);
+
+/*!
+ * \brief Populate the AFDO data from the samples of a perf.data file, in cycle accounting mode.
+ *
+ * The samples of each sampled instruction, weighted by their period, are its count. The inline stack
+ * of each sampled instruction is found by addr2line and its count is added to its stack, as for the
+ * instructions of the assembly views. The entry count of a function is the count of its first
+ * instruction. The LBR mode and the discriminators are not supported.
+ *
+ * \param profile The samples of the perf.data file
+ * \param data The AFDO data
+ * \param config The configuration
+ */
+void convert_perf_to_afdo(const perf_profile& profile, afdo_data& data, const converter_config& config);
+
+/*!
+ * \brief Populate the AFDO data from the samples of a perf.data file, within the given context.
+ * \param profile The samples of the perf.data file
+ * \param data The AFDO data
+ * \param config The configuration
+ * \param context The context of the conversion
  */
-void convert_to_afdo(const gooda_report& report, afdo_data& data, boost::program_options::variables_map& vm);
+void convert_perf_to_afdo(const perf_profile& profile, afdo_data& data, const converter_config& config, converter_context& context);
 
 }
 
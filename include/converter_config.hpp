@@ -0,0 +1,50 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file converter_config.hpp
+ * \brief Contains the configuration of the conversion, reading and writing of the profiles.
+ */
+
+#ifndef GOODA_CONVERTER_CONFIG_HPP
+#define GOODA_CONVERTER_CONFIG_HPP
+
+#include <string>
+
+namespace gooda {
+
+/*!
+ * \struct converter_config
+ * \brief The configuration of the converter library.
+ *
+ * The default configuration converts cycle accounting spreadsheets with the working set, using
+ * addr2line from the PATH and as many threads as cores.
+ */
+struct converter_config {
+    bool lbr = false;                           //!< Use the LBR counters instead of cycle accounting
+    bool auto_mode = false;                     //!< Detect the type of the spreadsheets
+    bool working_set = true;                    //!< Compute the working set
+    bool cache_misses = false;                  //!< Fill and read the cache misses of the stacks
+    bool discriminators = false;                //!< Find the DWARF discriminators of the instructions
+    bool debug = false;                         //!< Make the dumps more verbose
+
+    bool filter = false;                        //!< Only consider the hottest process
+    std::string process;                        //!< Only consider this process, if not empty
+
+    unsigned int top = 0;                       //!< Only convert the N hottest functions, 0 for all
+    double coverage = 0.0;                      //!< Only convert the hottest functions covering this fraction of the counter, 0 for all
+
+    std::string folder;                         //!< The directory in which to search the executables
+    std::string addr2line = "addr2line";        //!< The addr2line executable
+    std::string symcache;                       //!< The directory of the symbolization cache, empty to disable it
+
+    unsigned int jobs = 0;                      //!< The maximum number of threads, 0 for the number of cores
+};
+
+} //end of namespace gooda
+
+#endif
@@ -0,0 +1,131 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file daemon_context.hpp
+ * \brief Contains the state shared by the resident modes of the converter.
+ */
+
+#ifndef GOODA_DAEMON_CONTEXT_HPP
+#define GOODA_DAEMON_CONTEXT_HPP
+
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include <csignal>
+
+#include "converter_config.hpp"
+
+namespace gooda {
+
+class symbol_cache;
+
+class addr2line_pool;
+
+class converter_context;
+
+/*!
+ * \class daemon_context
+ * \brief The state of a converter running until SIGINT or SIGTERM is received: the stop signals, the
+ * addr2line processes and the symbols.
+ *
+ * The signal handler sets the stop flag and writes to a pipe, whose read end can be polled with the
+ * other descriptors of the daemon. A signal received before the poll is not lost. The symbols are
+ * kept in memory for all the conversions of the daemon, backed by the symcache directory of the
+ * configuration if any. All the conversions share a single pool of addr2line processes, whose idle
+ * processes are bounded by the number of jobs of the configuration.
+ *
+ * Only one daemon context can exist at a time.
+ */
+class daemon_context {
+    public:
+        /*!
+         * \brief Catch the stop signals and create the symbol cache.
+         * \param config The configuration of the daemon.
+         */
+        explicit daemon_context(const converter_config& config);
+
+        /*!
+         * \brief Restore the previous handlers of the stop signals.
+         */
+        ~daemon_context();
+
+        /*!
+         * \brief Deleted copy constructor
+         * \param other The other daemon context
+         */
+        daemon_context(const daemon_context& other) = delete;
+
+        /*!
+         * \brief Deleted copy assignment operator
+         * \param other The other daemon context
+         * \return A reference to this
+         */
+        daemon_context& operator=(const daemon_context& other) = delete;
+
+        /*!
+         * \brief Indicates if a stop signal has been received.
+         * \return true if the daemon must stop, false otherwise.
+         */
+        bool stopped() const;
+
+        /*!
+         * \brief Return the descriptor to poll to be woken by the stop signals.
+         * \return The read end of the stop pipe, readable once a stop signal has been received.
+         */
+        int stop_fd() const;
+
+        /*!
+         * \brief Prepare a context kept from one conversion to the next, with the addr2line processes and the symbol cache of the daemon.
+         * \param context The context of the conversions.
+         */
+        void init(converter_context& context) const;
+
+        /*!
+         * \brief Start a thread that never receives the stop signals, so that they wake the thread polling the stop pipe.
+         * \param args The function of the thread and its arguments.
+         * \return The started thread.
+         */
+        template<typename... Args>
+        std::thread spawn(Args&&... args) const {
+            sigset_t previous;
+            block_signals(previous);
+
+            //The thread inherits the mask blocking the signals
+            try {
+                std::thread thread(std::forward<Args>(args)...);
+                restore_signals(previous);
+                return thread;
+            } catch (...) {
+                restore_signals(previous);
+                throw;
+            }
+        }
+
+    private:
+        /*!
+         * \brief Block the stop signals in the calling thread.
+         * \param previous The previous mask of the thread.
+         */
+        static void block_signals(sigset_t& previous);
+
+        /*!
+         * \brief Restore the signal mask of the calling thread.
+         * \param previous The mask to restore.
+         */
+        static void restore_signals(const sigset_t& previous);
+
+        std::shared_ptr<addr2line_pool> pool;       //!< The addr2line processes of all the conversions
+        std::shared_ptr<symbol_cache> cache;        //!< The symbols kept for all the conversions
+        struct sigaction previous_int;              //!< The previous handler of SIGINT
+        struct sigaction previous_term;             //!< The previous handler of SIGTERM
+};
+
+}
+
+#endif
@@ -13,9 +13,8 @@
 #ifndef GOODA_DIFF_HPP
 #define GOODA_DIFF_HPP
 
-#include <boost/program_options/variables_map.hpp>
-
 #include "gooda_report.hpp"
+#include "converter_config.hpp"
 
 namespace gooda {
 
@@ -23,9 +22,9 @@ namespace gooda {
  * \brief Performs a diff between two Gooda reports. 
  * \param first_report The first Gooda report
  * \param second_report The second Gooda report. 
- * \param vm The options provided by the user. 
+ * \param config The options provided by the user. 
  */
-void diff(const gooda_report& first_report, const gooda_report& second_report, boost::program_options::variables_map& vm);
+void diff(const gooda_report& first_report, const gooda_report& second_report, const converter_config& config);
 
 }
 
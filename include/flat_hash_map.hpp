@@ -0,0 +1,176 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file flat_hash_map.hpp
+ * \brief Contains an open-addressing hash map.
+ */
+
+#ifndef GOODA_FLAT_HASH_MAP_HPP
+#define GOODA_FLAT_HASH_MAP_HPP
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <cstdint>
+
+namespace gooda {
+
+/*!
+ * \class flat_hash_map
+ * \brief A hash map storing its entries inline in a single array, with linear probing.
+ *
+ * A lookup does not allocate and generally touches a single cache line. The entries cannot be
+ * removed individually. The hash is spread with a Fibonacci hashing step, so that weak hash
+ * functions (like the identity on integers) can be used.
+ *
+ * \tparam Key The type of the keys.
+ * \tparam Value The type of the values.
+ * \tparam Hash The hash functor of the keys.
+ */
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+class flat_hash_map {
+    public:
+        /*!
+         * \brief Return the value of the given key.
+         * \param key The key to search.
+         * \return A pointer to the value of the key, nullptr if the key is not in the map.
+         */
+        Value* find(const Key& key){
+            if(slots.empty()){
+                return nullptr;
+            }
+
+            for(auto i = index(key);; i = (i + 1) & (slots.size() - 1)){
+                auto& slot = slots[i];
+
+                if(!slot.used){
+                    return nullptr;
+                } else if(slot.entry.first == key){
+                    return &slot.entry.second;
+                }
+            }
+        }
+
+        /*!
+         * \brief Return the value of the given key.
+         * \param key The key to search.
+         * \return A pointer to the value of the key, nullptr if the key is not in the map.
+         */
+        const Value* find(const Key& key) const {
+            return const_cast<flat_hash_map*>(this)->find(key);
+        }
+
+        /*!
+         * \brief Return the value of the given key, inserting a default value if the key is not in the map.
+         * \param key The key to search.
+         * \return A reference to the value of the key.
+         */
+        Value& operator[](const Key& key){
+            if((count + 1) * 4 > slots.size() * 3){
+                grow();
+            }
+
+            for(auto i = index(key);; i = (i + 1) & (slots.size() - 1)){
+                auto& slot = slots[i];
+
+                if(!slot.used){
+                    slot.used = true;
+                    slot.entry.first = key;
+                    ++count;
+
+                    return slot.entry.second;
+                } else if(slot.entry.first == key){
+                    return slot.entry.second;
+                }
+            }
+        }
+
+        /*!
+         * \brief Return the number of entries of the map.
+         * \return The number of entries of the map.
+         */
+        std::size_t size() const {
+            return count;
+        }
+
+        /*!
+         * \brief Remove all the entries of the map.
+         */
+        void clear(){
+            slots.clear();
+            count = 0;
+        }
+
+        /*!
+         * \brief Call the functor with the key and the value of each entry, in no particular order.
+         * \param functor The functor to call.
+         * \tparam Functor The type of the functor.
+         */
+        template<typename Functor>
+        void for_each(Functor functor){
+            for(auto& slot : slots){
+                if(slot.used){
+                    functor(slot.entry.first, slot.entry.second);
+                }
+            }
+        }
+
+    private:
+        /*!
+         * \struct slot
+         * \brief A slot of the table, empty or containing an entry.
+         */
+        struct slot {
+            bool used = false;                  //!< Indicates if the slot contains an entry
+            std::pair<Key, Value> entry;        //!< The entry
+        };
+
+        /*!
+         * \brief Return the first slot to probe for the given key.
+         * \param key The key.
+         * \return The index of the first slot to probe.
+         */
+        std::size_t index(const Key& key) const {
+            return static_cast<std::size_t>((static_cast<uint64_t>(Hash()(key)) * 0x9E3779B97F4A7C15ULL) >> shift);
+        }
+
+        /*!
+         * \brief Double the capacity of the table and insert back all the entries.
+         */
+        void grow(){
+            std::vector<slot> old;
+            old.swap(slots);
+
+            slots.resize(old.empty() ? 16 : old.size() * 2);
+
+            shift = 64;
+            for(auto size = slots.size(); size > 1; size >>= 1){
+                --shift;
+            }
+
+            for(auto& slot : old){
+                if(slot.used){
+                    auto i = index(slot.entry.first);
+                    while(slots[i].used){
+                        i = (i + 1) & (slots.size() - 1);
+                    }
+
+                    slots[i].used = true;
+                    slots[i].entry = std::move(slot.entry);
+                }
+            }
+        }
+
+        std::vector<slot> slots;            //!< The slots of the table, a power of two
+        std::size_t count = 0;              //!< The number of entries
+        unsigned int shift = 64;            //!< The shift giving the index of a slot from a hash
+};
+
+}
+
+#endif
@@ -86,6 +86,17 @@ class gcov_file {
          */
         void write_string (const std::string& value);
 
+        /*!
+         * \brief Copy the contents of another file, already in GCOV format, to the file.
+         * \param file The path to the file to copy.
+         */
+        void write_file(const std::string& file);
+
+        /*!
+         * \brief Flush and close the file opened for writing.
+         */
+        void close();
+
         /*!
          * \brief Read an unsigned from the file. 
          * \return The value read from the file. 
@@ -26,6 +26,48 @@ namespace gooda {
  */
 gooda_report read_spreadsheets(const std::string& directory);
 
+/*!
+ * \brief Read only the process and hotspot views of the Gooda spreadsheets.
+ *
+ * The assembly views can then be read one at a time with read_asm_view.
+ *
+ * \param directory The spreadsheets directory to read.
+ * \return The Gooda report without assembly and source views.
+ */
+gooda_report read_spreadsheet_index(const std::string& directory);
+
+/*!
+ * \brief Read the assembly view of a function into the Gooda report.
+ * \param directory The spreadsheets directory to read.
+ * \param i The index of the function.
+ * \param report The Gooda report to fill.
+ * \return true if the function has an assembly view, false otherwise.
+ */
+bool read_asm_view(const std::string& directory, std::size_t i, gooda_report& report);
+
+/*!
+ * \brief Indicates if a function has an assembly view, without reading it.
+ * \param directory The spreadsheets directory.
+ * \param i The index of the function.
+ * \return true if the assembly view file of the function exists, false otherwise.
+ */
+bool has_asm_view(const std::string& directory, std::size_t i);
+
+/*!
+ * \brief Indicates if the process and hotspot views of the Gooda spreadsheets have been completely written.
+ * \param directory The spreadsheets directory.
+ * \return true if both views are complete, false otherwise.
+ */
+bool spreadsheet_index_complete(const std::string& directory);
+
+/*!
+ * \brief Indicates if the assembly view of a function has been completely written.
+ * \param directory The spreadsheets directory.
+ * \param i The index of the function.
+ * \return true if the assembly view is complete, false otherwise.
+ */
+bool asm_view_complete(const std::string& directory, std::size_t i);
+
 }
 
 #endif
@@ -136,6 +136,12 @@ class gooda_report {
          */
         bool has_asm_file(std::size_t i) const;
 
+        /*!
+         * \brief Release the assembly view of the ith function, if any.
+         * \param i the index of the function.
+         */
+        void release_asm_file(std::size_t i);
+
         /*!
          * \brief Return the hotspot file. 
          * \return The gooda_file representing the hotspot functions.
@@ -0,0 +1,135 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file parallel.hpp
+ * \brief Contains utilities to run independent tasks on several threads.
+ */
+
+#ifndef GOODA_PARALLEL_HPP
+#define GOODA_PARALLEL_HPP
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
+namespace gooda {
+
+/*!
+ * \brief Return the number of threads to use for the given number of requested jobs.
+ * \param jobs The number of requested jobs, 0 to use all the available cores.
+ * \return The number of threads to use, at least 1.
+ */
+inline std::size_t thread_count(unsigned int jobs){
+    if(jobs == 0){
+        jobs = std::thread::hardware_concurrency();
+    }
+
+    return jobs == 0 ? 1 : jobs;
+}
+
+/*!
+ * \brief Call the functor for each index in [0, n) using at most the given number of threads.
+ *
+ * The indices are distributed dynamically to the threads. The calling thread takes part to the
+ * work. If a call throws, the remaining indices are skipped and the first exception is rethrown
+ * once all the threads are done.
+ *
+ * \param n The number of indices.
+ * \param jobs The maximum number of threads.
+ * \param functor The functor to call with each index.
+ * \tparam Functor The type of the functor.
+ */
+template<typename Functor>
+void parallel_for_each(std::size_t n, std::size_t jobs, Functor functor){
+    std::atomic<std::size_t> next(0);
+    std::exception_ptr error;
+    std::mutex error_lock;
+
+    auto worker = [&](){
+        std::size_t i;
+        while((i = next++) < n){
+            try {
+                functor(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> l(error_lock);
+
+                if(!error){
+                    error = std::current_exception();
+                }
+
+                next = n;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(std::size_t t = 1; t < jobs && t < n; ++t){
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for(auto& thread : threads){
+        thread.join();
+    }
+
+    if(error){
+        std::rethrow_exception(error);
+    }
+}
+
+/*!
+ * \brief The minimal number of elements sorted by each thread of parallel_sort.
+ */
+const std::size_t MIN_SORT_CHUNK = 1 << 16;
+
+/*!
+ * \brief Sort the range using at most the given number of threads.
+ *
+ * The range is split into chunks sorted concurrently, then the adjacent chunks are merged
+ * pairwise, the merges of a same level being done concurrently. The sort is not stable.
+ *
+ * \param first The beginning of the range.
+ * \param last The end of the range.
+ * \param compare The comparison functor.
+ * \param jobs The maximum number of threads.
+ * \tparam Iterator The type of random access iterator.
+ * \tparam Compare The type of the comparison functor.
+ */
+template<typename Iterator, typename Compare>
+void parallel_sort(Iterator first, Iterator last, Compare compare, std::size_t jobs){
+    std::size_t n = last - first;
+    std::size_t chunks = std::min(jobs, n / MIN_SORT_CHUNK);
+
+    if(chunks <= 1){
+        std::sort(first, last, compare);
+        return;
+    }
+
+    auto bound = [&](std::size_t chunk){
+        return first + std::min(chunk, chunks) * n / chunks;
+    };
+
+    parallel_for_each(chunks, jobs, [&](std::size_t chunk){
+        std::sort(bound(chunk), bound(chunk + 1), compare);
+    });
+
+    for(std::size_t width = 1; width < chunks; width *= 2){
+        parallel_for_each((chunks + 2 * width - 1) / (2 * width), jobs, [&](std::size_t pair){
+            auto chunk = pair * 2 * width;
+            std::inplace_merge(bound(chunk), bound(chunk + width), bound(chunk + 2 * width), compare);
+        });
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,65 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file perf_reader.hpp
+ * \brief Contains the reading of the samples of perf.data files.
+ */
+
+#ifndef GOODA_PERF_READER_HPP
+#define GOODA_PERF_READER_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "converter_config.hpp"
+
+namespace gooda {
+
+/*!
+ * \struct perf_function
+ * \brief The samples of a function, read from a perf.data file.
+ */
+struct perf_function {
+    std::string name;                                       //!< The symbol of the function
+    std::string executable_file;                            //!< The ELF file of the function, as recorded by perf
+    uint64_t address = 0;                                   //!< The address of the function in the ELF file
+    uint64_t size = 0;                                      //!< The size of the function
+    std::vector<std::pair<uint64_t, uint64_t>> samples;     //!< The sum of the periods of the samples of each sampled address, by increasing address
+};
+
+/*!
+ * \struct perf_profile
+ * \brief The samples of a perf.data file, aggregated by function and by address.
+ */
+struct perf_profile {
+    std::vector<perf_function> functions;   //!< The sampled functions
+    uint64_t samples = 0;                   //!< The number of user samples of the sampled event
+    uint64_t unresolved = 0;                //!< The number of these samples that are not in a function of a known ELF file
+};
+
+/*!
+ * \brief Read the samples of a perf.data file.
+ *
+ * Only the file format of perf record (not the pipe format) in the native byte order is read.
+ * The cycles event is selected if the file has several events, otherwise the first one. The
+ * instruction pointer of each user sample is resolved with the executable memory mappings of
+ * its process (MMAP and MMAP2 records) to an address of an ELF file and then to the function
+ * symbol containing it. The records are processed by time, the samples are weighted by their
+ * period if the file has it.
+ *
+ * \param file The perf.data file to read.
+ * \param config The configuration, giving the folder in which to search the executables.
+ * \return The samples of the file.
+ */
+perf_profile read_perf_data(const std::string& file, const converter_config& config);
+
+}
+
+#endif
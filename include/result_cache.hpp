@@ -0,0 +1,78 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file result_cache.hpp
+ * \brief Contains the cache of the generated AFDO profiles.
+ */
+
+#ifndef GOODA_RESULT_CACHE_HPP
+#define GOODA_RESULT_CACHE_HPP
+
+#include <string>
+
+#include "afdo_data.hpp"
+#include "converter_config.hpp"
+
+namespace gooda {
+
+/*!
+ * \class result_cache
+ * \brief A persistent cache of the AFDO profiles generated from the spreadsheets, addressed by their content.
+ *
+ * The key of a profile is a hash of the contents of the spreadsheets files, of the options that
+ * change the profile, of the identity of the addr2line tool and of the current directory, which is
+ * stripped from the paths of the profile. For each key, the cache stores the list of the executables
+ * the profile was generated from and one profile for each set of identities of these executables
+ * (their build-id, or a hash of their content if they have none). A profile is found again only if
+ * the spreadsheets, the options, the tools and the executables are the same, without reading the
+ * spreadsheets.
+ *
+ * The entries are written in temporary files and renamed, several converters can share the same
+ * directory. The entries are never removed by the converter.
+ */
+class result_cache {
+    public:
+        /*!
+         * \brief Create a cache stored in the given directory. The directory is created if necessary.
+         * \param directory The directory of the cache.
+         */
+        explicit result_cache(const std::string& directory);
+
+        /*!
+         * \brief Compute the key of the profile of a spreadsheets directory.
+         * \param spreadsheets The spreadsheets directory.
+         * \param config The configuration of the conversion.
+         * \return The key of the profile.
+         */
+        std::string key(const std::string& spreadsheets, const converter_config& config) const;
+
+        /*!
+         * \brief Copy the cached profile of the key to the output file, if any.
+         * \param key The key of the profile.
+         * \param config The configuration of the conversion.
+         * \param output The AFDO file to write.
+         * \return true if the profile was cached, false otherwise.
+         */
+        bool fetch(const std::string& key, const converter_config& config, const std::string& output) const;
+
+        /*!
+         * \brief Add a generated profile to the cache.
+         * \param key The key of the profile.
+         * \param data The AFDO data of the profile, giving its executables.
+         * \param config The configuration of the conversion.
+         * \param output The generated AFDO file.
+         */
+        void store(const std::string& key, const afdo_data& data, const converter_config& config, const std::string& output) const;
+
+    private:
+        std::string directory;      //!< The directory of the cache
+};
+
+}
+
+#endif
@@ -0,0 +1,45 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file server.hpp
+ * \brief Contains the resident conversion server.
+ */
+
+#ifndef GOODA_SERVER_HPP
+#define GOODA_SERVER_HPP
+
+#include <string>
+
+#include "converter_config.hpp"
+
+namespace gooda {
+
+/*!
+ * \brief Serve conversion requests on a Unix domain socket until SIGINT or SIGTERM is received.
+ *
+ * A request is a single line holding the arguments of a converter command line separated by tabs,
+ * for instance "--lbr\t-o\t/tmp/out.afdo\t/tmp/spreadsheets". The spreadsheets directory is
+ * converted to the output AFDO file and a single line is answered, starting with "OK" or with
+ * "ERROR" followed by the error message. The server does not know the working directory of its
+ * clients, the paths of a request (spreadsheets directory, output, folder and addr2line) must be
+ * absolute. A client must send its request within ten seconds of its connection.
+ *
+ * The requests are converted concurrently by a pool of workers. The workers share the addr2line
+ * processes kept between the requests, at most one idle process per job, and an in-memory symbol
+ * cache, backed by the symcache directory of the configuration if any, so that the symbols of the
+ * same executables are only resolved once. The processes and the symbols of the executables that
+ * have not been converted recently are released first.
+ *
+ * \param socket_path The path to the socket, replaced if it already exists.
+ * \param config The configuration of the server. Its number of jobs is the number of workers.
+ */
+void serve(const std::string& socket_path, const converter_config& config);
+
+}
+
+#endif
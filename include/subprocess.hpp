@@ -0,0 +1,110 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file subprocess.hpp
+ * \brief Contains the execution of child processes with streamed input and output.
+ */
+
+#ifndef GOODA_SUBPROCESS_HPP
+#define GOODA_SUBPROCESS_HPP
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include <sys/types.h>
+
+namespace gooda {
+
+/*!
+ * \typedef line_handler
+ * \brief Functor receiving each line of output of a child process, without the end of line.
+ * It returns false to stop reading the output.
+ */
+typedef std::function<bool(std::string&)> line_handler;
+
+/*!
+ * \class subprocess
+ * \brief A child process started with posix_spawn, with a socket to its standard input and a pipe from its standard output.
+ *
+ * The input is written while the output is read in large chunks and split into lines, so that
+ * the output is parsed while the child is still working.
+ */
+class subprocess {
+    public:
+        /*!
+         * \brief Start a new process. The program is searched in the PATH.
+         * \param args The program and its arguments.
+         */
+        explicit subprocess(const std::vector<std::string>& args);
+
+        /*!
+         * \brief Close the pipes and wait for the process.
+         */
+        ~subprocess();
+
+        /*!
+         * \brief Deleted copy constructor
+         * \param other The other process
+         */
+        subprocess(const subprocess& other) = delete;
+
+        /*!
+         * \brief Deleted copy assignment operator
+         * \param other The other process
+         * \return A reference to this
+         */
+        subprocess& operator=(const subprocess& other) = delete;
+
+        /*!
+         * \brief Write the input to the process and give each line of its output to the handler.
+         *
+         * The lines already read but not consumed by a previous call are given first. The call returns when
+         * the handler returns false or at the end of the output. A last line without end of line is only given
+         * at the end of the output.
+         *
+         * \param input The characters to write to the standard input of the process.
+         * \param handler The functor to call for each line.
+         * \param last If true, the standard input is closed once the input is written.
+         * \return true if the handler stopped the reading, false if the end of the output has been reached.
+         */
+        bool communicate(const std::string& input, const line_handler& handler, bool last);
+
+        /*!
+         * \brief Close the standard input and wait for the process to terminate.
+         * \return The exit code of the process, -1 if it did not exit normally.
+         */
+        int wait();
+
+    private:
+        /*!
+         * \brief Close the standard input of the process, if not already closed.
+         */
+        void close_input();
+
+        std::string command;        //!< The command, for the error messages
+        pid_t pid;                  //!< The pid of the process, -1 once waited
+        int input;                  //!< The write end of the standard input of the process
+        int output;                 //!< The read end of the standard output of the process
+        bool eof;                   //!< Indicates if the end of the output has been reached
+        std::string pending;        //!< The output read from the process but not consumed yet
+        std::size_t consumed;       //!< The number of characters of pending already consumed
+};
+
+/*!
+ * \brief Execute a program and give each line of its output to the handler.
+ * \param args The program and its arguments.
+ * \param input The characters to write to the standard input of the program.
+ * \param handler The functor to call for each line.
+ * \return The exit code of the program.
+ */
+int run_command(const std::vector<std::string>& args, const std::string& input, const std::function<void(std::string&)>& handler);
+
+}
+
+#endif
@@ -0,0 +1,148 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file symbol_cache.hpp
+ * \brief Contains the persistent cache of the symbolization results.
+ */
+
+#ifndef GOODA_SYMBOL_CACHE_HPP
+#define GOODA_SYMBOL_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <utility>
+#include <unordered_map>
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include "addr2line.hpp"
+
+namespace gooda {
+
+/*!
+ * \typedef symbol_frames
+ * \brief An address with the frames resolved by addr2line.
+ */
+typedef std::pair<std::string, std::vector<addr2line_frame>> symbol_frames;
+
+/*!
+ * \typedef symbol_name
+ * \brief An address with the name of the function found at this address, empty if there is none.
+ */
+typedef std::pair<std::string, std::string> symbol_name;
+
+/*!
+ * \class symbol_cache
+ * \brief A persistent cache of the symbolization results, stored in one file per GNU build-id.
+ *
+ * The results of addr2line (inline stacks and discriminators) and the function names found by objdump
+ * are appended to the file of the build-id of the executable. As the build-id identifies the content of
+ * the executable, the results remain valid across runs, machines and paths of the executable.
+ *
+ * Each record is a single line appended with a single write on a file opened in append mode, followed by
+ * a checksum. Several converters can share the same directory without locks, the torn or partial records
+ * are ignored at load time. Executables without a build-id are never cached.
+ *
+ * The number of build-ids kept in memory is bounded by the capacity of the cache. Beyond it, the results
+ * of the least recently used build-id are released, they are loaded again from the directory if needed.
+ *
+ * All the functions are thread-safe.
+ */
+class symbol_cache {
+    public:
+        /*!
+         * \brief Create a cache stored in the given directory. The directory is created if necessary.
+         *
+         * With an empty directory, the cache is only kept in memory, for the lifetime of the object.
+         *
+         * \param directory The directory of the cache.
+         * \param capacity The maximum number of build-ids kept in memory.
+         */
+        explicit symbol_cache(const std::string& directory, std::size_t capacity = 16);
+
+        /*!
+         * \brief Return the build-id of the executable.
+         * \param executable The path to the executable.
+         * \return The build-id of the executable or an empty string if it has none.
+         */
+        std::string build_id(const std::string& executable);
+
+        /*!
+         * \brief Split the addresses in the range [first, last) into the cached ones and the missing ones.
+         * \param id The build-id of the executable.
+         * \param first The first address to search.
+         * \param last The end of the range of addresses to search.
+         * \param hits The cached addresses with their frames.
+         * \param misses The addresses that are not in the cache.
+         */
+        void lookup_frames(const std::string& id, address_iterator first, address_iterator last, std::vector<symbol_frames>& hits, std::vector<std::string>& misses);
+
+        /*!
+         * \brief Return the cached function names of all the given addresses.
+         * \param id The build-id of the executable.
+         * \param addresses The addresses to search.
+         * \param names The cached addresses with their names.
+         * \return true if all the addresses were cached, false otherwise.
+         */
+        bool lookup_names(const std::string& id, const std::vector<std::string>& addresses, std::vector<symbol_name>& names);
+
+        /*!
+         * \brief Add the given addr2line results to the cache.
+         * \param id The build-id of the executable.
+         * \param entries The resolved addresses with their frames.
+         */
+        void store_frames(const std::string& id, const std::vector<symbol_frames>& entries);
+
+        /*!
+         * \brief Add the given function names to the cache.
+         * \param id The build-id of the executable.
+         * \param entries The addresses with their function names.
+         */
+        void store_names(const std::string& id, const std::vector<symbol_name>& entries);
+
+    private:
+        /*!
+         * \struct cached_binary
+         * \brief The cached results of one build-id.
+         */
+        struct cached_binary {
+            std::unordered_map<unsigned long long, std::vector<addr2line_frame>> frames;    //!< The addr2line results
+            std::unordered_map<unsigned long long, std::string> names;                     //!< The objdump results
+            uint64_t last_use = 0;                                                          //!< The time of the last use of the results
+        };
+
+        /*!
+         * \brief Return the cached results of the build-id, loading them from disk if necessary.
+         *
+         * If the capacity is reached, the results of the least recently used build-id are released.
+         *
+         * \param id The build-id.
+         * \return The cached results of the build-id.
+         */
+        cached_binary& binary(const std::string& id);
+
+        /*!
+         * \brief Append the records to the file of the build-id.
+         * \param id The build-id.
+         * \param records The records to append.
+         */
+        void append(const std::string& id, const std::string& records);
+
+        std::string directory;                                                          //!< The directory of the cache
+        std::size_t capacity;                                                           //!< The maximum number of loaded build-ids
+        uint64_t clock = 0;                                                             //!< The number of uses of the loaded build-ids
+        std::mutex lock;                                                                //!< Protect the loaded binaries and build-ids
+        std::unordered_map<std::string, cached_binary> binaries;                        //!< The loaded build-ids
+        std::unordered_map<std::string, std::pair<time_t, std::string>> build_ids;      //!< The known build-ids by executable
+};
+
+}
+
+#endif
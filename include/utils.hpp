@@ -14,6 +14,7 @@
 #define GOODA_UTILS_HPP
 
 #include <string>
+#include <vector>
 
 namespace gooda {
 
@@ -32,18 +33,57 @@ bool exists(const std::string& file);
 bool is_directory(const std::string& file);
 
 /*!
- * \brief Execute a command and return the return code of the command. 
- * \param command The command to execute.  
- * \return The return code of the command. 
+ * \brief Test if two paths designate the same existing file.
+ * \param first The first path.
+ * \param second The second path.
+ * \return true if both paths exist and are the same file, false otherwise.
  */
-int exec_command(const std::string& command);
+bool same_file(const std::string& first, const std::string& second);
+
+/*!
+ * \brief Return the current working directory.
+ * \return The absolute path of the current directory.
+ */
+std::string current_directory();
+
+/*!
+ * \brief Return the name of the AFDO file of a partition of the profile.
+ *
+ * The name of the partition is inserted before the extension of the output file. The characters
+ * that are not safe in a file name are replaced by underscores.
+ *
+ * \param output The output file
+ * \param partition The name of the partition (process, module or set of spreadsheets)
+ * \return The name of the AFDO file of the partition
+ */
+std::string partition_output(const std::string& output, const std::string& partition);
 
 /*!
- * \brief Execute a command and return the its output.
+ * \brief Return the names of the AFDO files of several partitions of the profile, all distinct.
+ *
+ * Different partitions can have the same name once the unsafe characters are replaced (for instance
+ * "a/b" and "a_b"). The first of them keeps the name, the next ones get a numbered suffix.
+ *
+ * \param output The output file
+ * \param partitions The names of the partitions
+ * \return The name of the AFDO file of each partition, in the same order
+ */
+std::vector<std::string> partition_outputs(const std::string& output, const std::vector<std::string>& partitions);
+
+/*!
+ * \brief Return the path of an executable file, taking the folder option into account.
+ * \param executable_file The executable file, as reported by the profiler
+ * \param folder The folder in which to search the executables, empty to use the executable file as is
+ * \return The path to the executable file
+ */
+std::string executable_path(const std::string& executable_file, const std::string& folder);
+
+/*!
+ * \brief Execute a command and return the return code of the command. 
  * \param command The command to execute.  
- * \return The output of the command. 
+ * \return The return code of the command. 
  */
-std::string exec_command_result(const std::string& command);
+int exec_command(const std::string& command);
 
 /*!
  * \return The model of the current processor. 
@@ -0,0 +1,45 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file watcher.hpp
+ * \brief Contains the conversion of the spreadsheets as they are written in a directory.
+ */
+
+#ifndef GOODA_WATCHER_HPP
+#define GOODA_WATCHER_HPP
+
+#include <string>
+
+#include "converter_config.hpp"
+
+namespace gooda {
+
+/*!
+ * \brief Watch a directory and convert each new spreadsheets directory written in it, until SIGINT or SIGTERM is received.
+ *
+ * A spreadsheets directory is converted as soon as its process and hotspot views and the
+ * assembly views of all its hotspot functions are complete. Gooda does not write an assembly view
+ * for every hotspot function. Once its hotspot view is complete, a directory without any event for
+ * ten seconds is therefore converted without its missing assembly views. The AFDO profile of the spreadsheets
+ * directory "name" is named after the output file and "name", like the profiles of --split-by-process.
+ * The spreadsheets directories already present when the watch starts are converted if their
+ * profile does not exist yet.
+ *
+ * The addr2line processes and the symbols are kept from one conversion to the next, the symbols
+ * being kept in memory and in the symcache directory of the configuration if any. The processes and
+ * the symbols of the executables that have not been converted recently are released first.
+ *
+ * \param directory The directory to watch.
+ * \param output The output file, used to name the profiles.
+ * \param config The configuration of the conversions.
+ */
+void watch(const std::string& directory, const std::string& output, const converter_config& config);
+
+}
+
+#endif
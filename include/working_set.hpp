@@ -0,0 +1,79 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file working_set.hpp
+ * \brief Contains the computation of the working set of an AFDO profile.
+ */
+
+#ifndef GOODA_WORKING_SET_HPP
+#define GOODA_WORKING_SET_HPP
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "afdo_data.hpp"
+
+namespace gooda {
+
+/*!
+ * \brief Compute the working set of a profile from the counts of its instructions.
+ *
+ * The counts are ranked by decreasing value and the buckets are filled in a single sweep
+ * over the ranked counts.
+ *
+ * \param counts The count of each instruction. The counts are reordered.
+ * \param total_count The sum of the counts.
+ * \param data The AFDO profile whose working set is filled.
+ * \param jobs The number of threads used to rank the counts.
+ */
+void compute_working_set(std::vector<uint64_t>& counts, uint64_t total_count, afdo_data& data, std::size_t jobs);
+
+/*!
+ * \brief Compute the working set of a profile from the histogram of the counts of its instructions.
+ *
+ * The histogram holds one entry per distinct count, its size does not depend on the number of
+ * instructions of the profile.
+ *
+ * \param histogram The number of instructions of each count. The histogram is reordered.
+ * \param total_count The sum of the counts.
+ * \param data The AFDO profile whose working set is filled.
+ */
+void compute_working_set(std::vector<std::pair<uint64_t, uint64_t>>& histogram, uint64_t total_count, afdo_data& data);
+
+/*!
+ * \brief Collect the histogram of the counts of the instructions of a profile from its inline stacks.
+ *
+ * Each stack stands for num_inst instructions. In cycle accounting, the count of a stack is the sum of
+ * the counts of its instructions, they share it evenly and the first ones receive the remainder. In
+ * LBR, the count of a stack is already the count of each of its instructions (the largest execution
+ * count of their basic blocks).
+ *
+ * The instructions are not expanded, the histogram holds one entry per distinct count.
+ *
+ * \param data The AFDO profile.
+ * \param lbr Indicates if the profile comes from LBR.
+ * \param histogram The histogram receiving the number of instructions of each count.
+ * \param total_count The sum of the counts, incremented by the collected counts.
+ */
+void collect_stack_counts(const afdo_data& data, bool lbr, std::vector<std::pair<uint64_t, uint64_t>>& histogram, uint64_t& total_count);
+
+/*!
+ * \brief Recompute the working set of a profile from its inline stacks, without the Gooda spreadsheets.
+ *
+ * The histogram of the counts is collected with collect_stack_counts. The function section is
+ * traversed once.
+ *
+ * \param data The AFDO profile whose working set is recomputed.
+ * \param lbr Indicates if the profile comes from LBR.
+ */
+void recompute_working_set(afdo_data& data, bool lbr);
+
+}
+
+#endif
@@ -10,12 +10,13 @@
  * \brief Implementation of the command line arguments management.
  */
 
+#include <iostream>
+
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/variables_map.hpp>
 
 #include "Options.hpp"
-#include "logger.hpp"
 #include "gooda_exception.hpp"
 
 void gooda::options::parse(int argc, const char **argv){
@@ -24,9 +25,13 @@ void gooda::options::parse(int argc, const char **argv){
         input.add_options()
             ("read-spreadsheets", "Read Gooda spreadsheets (default)")
             ("read-afdo", "Read an existing AFDO profile")
+            ("read-perf", "Read the samples of a perf.data file instead of Gooda spreadsheets")
             ("profile,p", "Profile the given application.")
             ("diff", "Diff between two sets of spreadsheets (prototype)")
             ("afdo-diff", "Diff between two AFDO profile")
+            ("aggregate", "Aggregate several sets of spreadsheets into a single AFDO profile")
+            ("serve", po::value<std::string>(), "Serve conversion requests on the given Unix domain socket")
+            ("watch", po::value<std::string>(), "Watch the given directory and convert each new set of spreadsheets as soon as it is complete")
             ;
         
         po::options_description output("Output actions");
@@ -34,6 +39,7 @@ void gooda::options::parse(int argc, const char **argv){
             ("dump", "Dump AFDO profile on standard output")
             ("full-dump", "Dump complete AFDO profile on standard output")
             ("afdo", "Generate an AFDO profile (default if --profile is not selected)")
+            ("stream", "Generate the AFDO profile one function at a time, with a memory usage bounded by the largest function")
             ;
         
         po::options_description afdo("AFDO Options");
@@ -41,6 +47,7 @@ void gooda::options::parse(int argc, const char **argv){
             ("lbr", "Performs precise profile with LBR (The default is cycle accounting)")
             ("auto", "Detect the type of the spreadsheets (Not valid with profile)")
             ("nows", "Do not compute the working set")
+            ("recompute-ws", "Recompute the working set of the profile read with --read-afdo from its inline stacks (with --lbr for LBR profiles)")
             ("cache-misses", "Fill cache misses information in the AFDO file")
             ("discriminators", "Find the DWARF discriminators of instructions, need >=binutils.2.23.1")
             ;
@@ -56,13 +63,23 @@ void gooda::options::parse(int argc, const char **argv){
             //There is a bug in Boost PO that prevent implicit value and positional options at the same time
             ("filter,f", "Only consider the hottest process.")
             ("process", po::value<std::string>(), "Filter the hotspot functions by process.")
+            ("split-by-process", "Generate one AFDO profile for each process, named after the output file and the process")
+            ("split-by-module", "Generate one AFDO profile for each executable file, named after the output file and the executable")
+            ("weights", po::value<std::string>(), "Comma-separated weights of the aggregated sets of spreadsheets (default: 1 for each)")
+            ("update-from", po::value<std::string>(), "Update the given AFDO profile with the spreadsheets instead of generating a new one")
+            ("decay", po::value<double>(), "The factor applied to the counts of the profile given with --update-from (between 0 and 1, default: 0.5)")
+            ("top", po::value<unsigned int>(), "Only convert the N hottest functions")
+            ("coverage", po::value<double>(), "Only convert the hottest functions covering this fraction of the counter (between 0 and 1)")
             ("output,o", po::value<std::string>()->default_value("fbdata.afdo"), "The name of the generated AFDO file")
             ("log", po::value<int>()->default_value(0), "Define the logging verbosity (0: No logging, 1: warnings, 2:debug 3:trace)")
             ("quiet", "Output as less as possible on the console")
+            ("jobs,j", po::value<unsigned int>()->default_value(0), "The maximum number of threads to use (0: the number of cores)")
 
             ("gooda", po::value<std::string>(), "Path to the Gooda installation directory. By default, $GOODA_DIR or the current directory will be used")
             ("addr2line", po::value<std::string>()->default_value("addr2line"), "Specify the addr2line executable to use")
             ("folder", po::value<std::string>()->default_value(""), "Specify in which to search the executable")
+            ("symcache", po::value<std::string>(), "Directory of the persistent symbolization cache, indexed by the build-id of the executables")
+            ("result-cache", po::value<std::string>(), "Directory of the cache of the generated profiles, indexed by the spreadsheets, the options and the executables")
             ("input-file", po::value<std::vector<std::string>>(), "Input file(s)");
 
         description.add(input).add(output).add(afdo).add(others);
@@ -86,14 +103,65 @@ void gooda::options::parse(int argc, const char **argv){
             throw gooda::gooda_exception("--auto and --lbr cannot be used together");
         }
         
+        if(vm.count("recompute-ws") && !vm.count("read-afdo")){
+            throw gooda::gooda_exception("--recompute-ws can only be used with --read-afdo");
+        }
+
+        if(vm.count("coverage") && (vm["coverage"].as<double>() <= 0.0 || vm["coverage"].as<double>() > 1.0)){
+            throw gooda::gooda_exception("--coverage must be in (0, 1]");
+        }
+
+        if(vm.count("split-by-process") && (vm.count("filter") || vm.count("process"))){
+            throw gooda::gooda_exception("--split-by-process cannot be used with --filter or --process");
+        }
+
+        if(vm.count("split-by-process") && vm.count("split-by-module")){
+            throw gooda::gooda_exception("--split-by-process and --split-by-module cannot be used together");
+        }
+
+        if(vm.count("aggregate") && (vm.count("split-by-process") || vm.count("split-by-module"))){
+            throw gooda::gooda_exception("--aggregate cannot be used with --split-by-process or --split-by-module");
+        }
+
+        if(vm.count("decay") && !vm.count("update-from")){
+            throw gooda::gooda_exception("--decay can only be used with --update-from");
+        }
+
+        if(vm.count("decay") && (vm["decay"].as<double>() < 0.0 || vm["decay"].as<double>() > 1.0)){
+            throw gooda::gooda_exception("--decay must be in [0, 1]");
+        }
+
+        if(vm.count("update-from") && (vm.count("split-by-process") || vm.count("split-by-module") || vm.count("aggregate") || vm.count("stream"))){
+            throw gooda::gooda_exception("--update-from cannot be used with --split-by-process, --split-by-module, --aggregate or --stream");
+        }
+
+        if(vm.count("stream") && (vm.count("dump") || vm.count("full-dump") || vm.count("split-by-process") || vm.count("split-by-module") || vm.count("aggregate"))){
+            throw gooda::gooda_exception("--stream can only generate a single AFDO profile");
+        }
+
+        if(vm.count("watch") && (vm.count("dump") || vm.count("full-dump") || vm.count("split-by-process") || vm.count("split-by-module") || vm.count("aggregate") || vm.count("stream") || vm.count("update-from") || vm.count("serve"))){
+            throw gooda::gooda_exception("--watch can only generate a single AFDO profile for each set of spreadsheets");
+        }
+
+        if(vm.count("result-cache") && (vm.count("dump") || vm.count("full-dump") || vm.count("split-by-process") || vm.count("split-by-module") || vm.count("aggregate") || vm.count("stream") || vm.count("update-from") || vm.count("serve") || vm.count("watch"))){
+            throw gooda::gooda_exception("--result-cache can only be used to generate a single AFDO profile from one set of spreadsheets");
+        }
+
+        if(vm.count("read-perf") && (vm.count("lbr") || vm.count("auto") || vm.count("cache-misses") || vm.count("filter") || vm.count("process") || vm.count("split-by-process") || vm.count("split-by-module")
+                || vm.count("aggregate") || vm.count("stream") || vm.count("update-from") || vm.count("result-cache") || vm.count("serve") || vm.count("watch"))){
+            throw gooda::gooda_exception("--read-perf can only generate a single cycle accounting AFDO profile");
+        }
+
+        if(vm.count("read-perf") && vm.count("discriminators")){
+            throw gooda::gooda_exception("--discriminators is not supported with --read-perf");
+        }
+
         if(vm.count("lbr") && vm.count("cache-misses")){
             throw gooda::gooda_exception("Gooda does not support cache misses in LBR mode");
         }
     } catch (std::exception& e ) {
         throw gooda::gooda_exception(e.what());
     }
-    
-    log::set_level(vm["log"].as<int>());
 }
 
 void gooda::options::notify(){
@@ -118,3 +186,37 @@ void gooda::options::notify(){
         throw gooda::gooda_exception(e.what());
     }
 }
+
+gooda::converter_config gooda::make_config(const po::variables_map& vm){
+    converter_config config;
+
+    config.lbr = vm.count("lbr");
+    config.auto_mode = vm.count("auto");
+    config.working_set = !vm.count("nows");
+    config.cache_misses = vm.count("cache-misses");
+    config.discriminators = vm.count("discriminators");
+    config.debug = vm.count("debug");
+
+    config.filter = vm.count("filter");
+    if(vm.count("process")){
+        config.process = vm["process"].as<std::string>();
+    }
+
+    if(vm.count("top")){
+        config.top = vm["top"].as<unsigned int>();
+    }
+
+    if(vm.count("coverage")){
+        config.coverage = vm["coverage"].as<double>();
+    }
+
+    config.folder = vm["folder"].as<std::string>();
+    config.addr2line = vm["addr2line"].as<std::string>();
+    if(vm.count("symcache")){
+        config.symcache = vm["symcache"].as<std::string>();
+    }
+
+    config.jobs = vm["jobs"].as<unsigned int>();
+
+    return config;
+}
@@ -0,0 +1,196 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file addr2line.cpp
+ * \brief Implementation of the addr2line coprocesses.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#include "addr2line.hpp"
+#include "parallel.hpp"
+#include "logger.hpp"
+#include "gooda_exception.hpp"
+
+namespace {
+
+/*!
+ * \brief The address sent after each query. Its answer indicates that all the previous addresses have been answered.
+ */
+const char* const SENTINEL = "0\n";
+
+/*!
+ * \brief Indicates if the given line is an address line (printed by addr2line -a).
+ * \param line The line to test.
+ * \return true if the line is an address, false otherwise.
+ */
+bool is_address(const std::string& line){
+    if(line.size() < 3 || line[0] != '0' || line[1] != 'x'){
+        return false;
+    }
+
+    for(std::size_t i = 2; i < line.size(); ++i){
+        if(!isxdigit(line[i])){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} //end of anonymous namespace
+
+gooda::addr2line_process::addr2line_process(const std::string& addr2line, const std::string& executable) :
+        executable(executable), process({addr2line, "-f", "-a", "-i", "--exe=" + executable}) {
+    struct stat st;
+    if(stat(executable.c_str(), &st) == -1){
+        throw gooda::gooda_exception("Unable to stat \"" + executable + "\": " + strerror(errno));
+    }
+
+    modification = st.st_mtime;
+    inode = st.st_ino;
+}
+
+bool gooda::addr2line_process::stale() const {
+    struct stat st;
+
+    return stat(executable.c_str(), &st) == -1 || st.st_mtime != modification || st.st_ino != inode;
+}
+
+void gooda::addr2line_process::query(address_iterator first, address_iterator last, const addr2line_callback& callback){
+    std::string request;
+    for(auto it = first; it != last; ++it){
+        request += *it;
+        request += '\n';
+    }
+    request += SENTINEL;
+
+    std::size_t answered = 0;   //The number of address lines read
+    bool in_answer = false;     //false while skipping the answer of the previous sentinel
+    bool has_function = false;
+
+    std::vector<addr2line_frame> frames;
+    addr2line_frame frame;
+
+    auto complete = process.communicate(request, [&](std::string& line){
+        if(is_address(line)){
+            if(in_answer){
+                callback(*(first + (answered - 1)), frames);
+                frames.clear();
+            }
+
+            //The answer to the sentinel, everything has been answered
+            if(answered == static_cast<std::size_t>(last - first)){
+                return false;
+            }
+
+            ++answered;
+            in_answer = true;
+            has_function = false;
+        } else if(in_answer){
+            //Each frame is made of the function line followed by the location line
+            if(has_function){
+                frame.location = std::move(line);
+                frames.push_back(std::move(frame));
+                has_function = false;
+            } else {
+                frame.function = std::move(line);
+                has_function = true;
+            }
+        }
+
+        return true;
+    }, false);
+
+    if(!complete){
+        throw gooda::gooda_exception("addr2line terminated unexpectedly for \"" + executable + "\"");
+    }
+}
+
+gooda::addr2line_pool::addr2line_pool(std::size_t capacity) : capacity(capacity == 0 ? gooda::thread_count(0) : capacity) {}
+
+void gooda::addr2line_pool::query(const std::string& addr2line, const std::string& executable, address_iterator first, address_iterator last, const addr2line_callback& callback){
+    std::unique_ptr<addr2line_process> process;
+    std::vector<std::unique_ptr<addr2line_process>> terminated;
+
+    {
+        std::lock_guard<std::mutex> l(lock);
+
+        auto it = idle.find({addr2line, executable});
+
+        if(it != idle.end()){
+            auto& processes = it->second.processes;
+
+            if(processes.back()->stale()){
+                log::emit<log::Debug>() << executable << " changed, restart addr2line" << log::endl;
+
+                terminated = std::move(processes);
+                processes.clear();
+            } else {
+                process = std::move(processes.back());
+                processes.pop_back();
+            }
+
+            idle_count -= terminated.size() + (process ? 1 : 0);
+
+            //Only the executables with idle processes are kept
+            if(processes.empty()){
+                idle.erase(it);
+            }
+        }
+    }
+
+    //The processes are terminated outside of the lock, waiting for them does not block the other queries
+    terminated.clear();
+
+    if(!process){
+        process.reset(new addr2line_process(addr2line, executable));
+    }
+
+    //If the query fails, the state of the process is unknown, it is not given back to the pool
+    process->query(first, last, callback);
+
+    {
+        std::lock_guard<std::mutex> l(lock);
+
+        auto& entry = idle[{addr2line, executable}];
+        entry.processes.push_back(std::move(process));
+        entry.last_use = ++clock;
+        ++idle_count;
+
+        //The processes of the least recently queried executables are terminated first
+        while(idle_count > capacity){
+            auto oldest = idle.begin();
+            for(auto it = idle.begin(); it != idle.end(); ++it){
+                if(it->second.last_use < oldest->second.last_use){
+                    oldest = it;
+                }
+            }
+
+            terminated.push_back(std::move(oldest->second.processes.back()));
+            oldest->second.processes.pop_back();
+            --idle_count;
+
+            if(oldest->second.processes.empty()){
+                log::emit<log::Debug>() << "Release the addr2line processes of " << oldest->first.second << log::endl;
+
+                idle.erase(oldest);
+            }
+        }
+    }
+}
+
+std::size_t gooda::addr2line_pool::idle_processes(const std::string& addr2line, const std::string& executable){
+    std::lock_guard<std::mutex> l(lock);
+
+    auto it = idle.find({addr2line, executable});
+    return it == idle.end() ? 0 : it->second.processes.size();
+}
@@ -11,6 +11,7 @@
  */
 
 #include <iostream>
+#include <algorithm>
 
 #include "afdo_diff.hpp"
 #include "assert.hpp"
@@ -116,9 +117,9 @@ void print_difference(std::string name, long first, long second){
  * \param second_data The second AFDO profile
  * \param first The first AFDO function
  * \param second The second AFDO function
- * \param vm The configuration
+ * \param config The configuration
  */
-void diff(const gooda::afdo_data& first_data, const gooda::afdo_data& second_data, gooda::afdo_function& first, gooda::afdo_function& second, boost::program_options::variables_map& vm){
+void diff(const gooda::afdo_data& first_data, const gooda::afdo_data& second_data, gooda::afdo_function& first, gooda::afdo_function& second, const gooda::converter_config& config){
     std::cout << "Diff of " << first.name << " function " << std::endl;
 
     if(first.file != second.file){
@@ -159,7 +160,7 @@ void diff(const gooda::afdo_data& first_data, const gooda::afdo_data& second_dat
         std::cout << "  " << not_in_second << " inline stack present in first are not in second" << std::endl;
         for(auto& first_stack : first.stacks){
             if(!has_stack(second, first_stack)){
-                dump_afdo(first_data, first_stack, vm);
+                dump_afdo(first_data, first_stack, config);
             }
         }
     }
@@ -168,7 +169,7 @@ void diff(const gooda::afdo_data& first_data, const gooda::afdo_data& second_dat
         std::cout << "  " << not_in_first << " inline stack present in second are not in first" << std::endl;
         for(auto& second_stack : second.stacks){
             if(!has_stack(first, second_stack)){
-                dump_afdo(second_data, second_stack, vm);
+                dump_afdo(second_data, second_stack, config);
             }
         }
     }
@@ -178,7 +179,7 @@ void diff(const gooda::afdo_data& first_data, const gooda::afdo_data& second_dat
 
 } //end of anonymous namespace
 
-void gooda::afdo_diff(const afdo_data& first, const afdo_data& second, boost::program_options::variables_map& vm){
+void gooda::afdo_diff(const afdo_data& first, const afdo_data& second, const gooda::converter_config& config){
     if(first.functions.size() > second.functions.size()){
         std::cout << "First has " << (first.functions.size() - second.functions.size()) << " more hotpot functions than second" << std::endl<< std::endl;
     } else if(second.functions.size() > first.functions.size()){
@@ -214,7 +215,7 @@ void gooda::afdo_diff(const afdo_data& first, const afdo_data& second, boost::pr
                     auto& first_function = first_functions[i];
                     auto& second_function = second_functions[j];
 
-                    diff(first, second, first_function, second_function, vm);
+                    diff(first, second, first_function, second_function, config);
 
                     found = true;
                     break;
@@ -234,7 +235,7 @@ void gooda::afdo_diff(const afdo_data& first, const afdo_data& second, boost::pr
                     auto& first_function = first_functions[j];
                     auto& second_function = second_functions[i];
 
-                    diff(first, second, first_function, second_function, vm);
+                    diff(first, second, first_function, second_function, config);
 
                     found = true;
                     break;
@@ -248,7 +249,7 @@ void gooda::afdo_diff(const afdo_data& first, const afdo_data& second, boost::pr
             auto& first_function = first_functions[i];
             auto& second_function = second_functions[i];
 
-            diff(first, second, first_function, second_function, vm);
+            diff(first, second, first_function, second_function, config);
         }
     }
 }
@@ -11,9 +11,15 @@
  */
 
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
 
 #include "afdo_generator.hpp"
-#include "gcov_file.hpp"
+#include "gooda_exception.hpp"
 #include "logger.hpp"
 
 namespace {
@@ -52,38 +58,49 @@ void write_file_name_table(const gooda::afdo_data& data, gooda::gcov_file& gcov_
 }
 
 /*!
- * \brief Write the hotspot function table.
- * \param data The AFDO profile.  
- * \param vm The configuration. 
+ * \brief Write the profile of a function.
+ * \param data The AFDO profile holding the file name table.
+ * \param function The function to write.
+ * \param config The configuration.
  * \param gcov_file The file to write to.
  */
-void write_function_table(const gooda::afdo_data& data, boost::program_options::variables_map& vm, gooda::gcov_file& gcov_file){
-    gcov_file.write_section_header(GCOV_TAG_AFDO_FUNCTION, data.length_function_section);
+void write_function(const gooda::afdo_data& data, const gooda::afdo_function& function, const gooda::converter_config& config, gooda::gcov_file& gcov_file){
+    gcov_file.write_string(function.name);
 
-    write_collection(data.functions, gcov_file, [&data,&vm, &gcov_file](const gooda::afdo_function& function){
-        gcov_file.write_string(function.name);
+    gcov_file.write_unsigned(data.get_file_index(function.file));
 
-        gcov_file.write_unsigned(data.get_file_index(function.file));
+    gcov_file.write_counter(function.total_count);
+    gcov_file.write_counter(function.entry_count);
 
-        gcov_file.write_counter(function.total_count);
-        gcov_file.write_counter(function.entry_count);
+    write_collection(function.stacks, gcov_file, [&data,&config, &gcov_file](const gooda::afdo_stack& stack){
+        write_collection(stack.stack, gcov_file, [&data, &gcov_file](const gooda::afdo_pos& s){
+            gcov_file.write_unsigned(data.get_file_index(s.func));
+            gcov_file.write_unsigned(data.get_file_index(s.file));
 
-        write_collection(function.stacks, gcov_file, [&data,&vm, &gcov_file](const gooda::afdo_stack& stack){
-            write_collection(stack.stack, gcov_file, [&data, &gcov_file](const gooda::afdo_pos& s){
-                gcov_file.write_unsigned(data.get_file_index(s.func));
-                gcov_file.write_unsigned(data.get_file_index(s.file));
+            gcov_file.write_unsigned(s.line);
+            gcov_file.write_unsigned(s.discriminator);
+        });
 
-                gcov_file.write_unsigned(s.line);
-                gcov_file.write_unsigned(s.discriminator);
-            });
+        gcov_file.write_counter(stack.count);
+        gcov_file.write_counter(stack.num_inst);
 
-            gcov_file.write_counter(stack.count);
-            gcov_file.write_counter(stack.num_inst);
+        if(config.cache_misses){
+            gcov_file.write_counter(stack.cache_misses);
+        }
+    });
+}
 
-            if(vm.count("cache-misses")){
-                gcov_file.write_counter(stack.cache_misses);
-            }
-        });
+/*!
+ * \brief Write the hotspot function table.
+ * \param data The AFDO profile.  
+ * \param config The configuration. 
+ * \param gcov_file The file to write to.
+ */
+void write_function_table(const gooda::afdo_data& data, const gooda::converter_config& config, gooda::gcov_file& gcov_file){
+    gcov_file.write_section_header(GCOV_TAG_AFDO_FUNCTION, data.length_function_section);
+
+    write_collection(data.functions, gcov_file, [&data,&config, &gcov_file](const gooda::afdo_function& function){
+        write_function(data, function, config, gcov_file);
     });
 }
 
@@ -130,7 +147,7 @@ void write_working_set(const gooda::afdo_data& data, gooda::gcov_file& gcov_file
 
 } //end of anonymous namespace
 
-void gooda::generate_afdo(const afdo_data& data, const std::string& file, boost::program_options::variables_map& vm){
+void gooda::generate_afdo(const afdo_data& data, const std::string& file, const gooda::converter_config& config){
     log::emit<log::Debug>() << "Generate AFDO profile in \"" << file << "\"" << log::endl;
 
     gooda::gcov_file gcov_file;
@@ -139,7 +156,58 @@ void gooda::generate_afdo(const afdo_data& data, const std::string& file, boost:
     gcov_file.write_header();
 
     write_file_name_table(data, gcov_file);
-    write_function_table(data, vm, gcov_file);
+    write_function_table(data, config, gcov_file);
+    write_module_info(data, gcov_file);
+    write_working_set(data, gcov_file);
+}
+
+gooda::afdo_spool::afdo_spool(const std::string& file, const gooda::converter_config& config) : config(config), count(0) {
+    //The spool has a unique name next to the output, it never replaces an existing file
+    std::string name = file + ".XXXXXX";
+
+    int fd = mkstemp(&name[0]);
+    if(fd == -1){
+        throw gooda::gooda_exception("Unable to create the spool of \"" + file + "\": " + strerror(errno));
+    }
+
+    close(fd);
+
+    this->file = name;
+
+    try {
+        spool_file.open(this->file);
+    } catch (...) {
+        std::remove(this->file.c_str());
+        throw;
+    }
+}
+
+gooda::afdo_spool::~afdo_spool(){
+    std::remove(file.c_str());
+}
+
+void gooda::afdo_spool::write(const afdo_data& data, const afdo_function& function){
+    write_function(data, function, config, spool_file);
+
+    ++count;
+}
+
+void gooda::generate_afdo(const afdo_data& data, afdo_spool& spool, const std::string& file, const gooda::converter_config& /*config*/){
+    log::emit<log::Debug>() << "Generate AFDO profile in \"" << file << "\" from " << spool.count << " spooled functions" << log::endl;
+
+    spool.spool_file.close();
+
+    gooda::gcov_file gcov_file;
+    gcov_file.open(file);
+
+    gcov_file.write_header();
+
+    write_file_name_table(data, gcov_file);
+
+    gcov_file.write_section_header(GCOV_TAG_AFDO_FUNCTION, data.length_function_section);
+    gcov_file.write_unsigned(spool.count);
+    gcov_file.write_file(spool.file);
+
     write_module_info(data, gcov_file);
     write_working_set(data, gcov_file);
 }
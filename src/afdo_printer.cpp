@@ -12,6 +12,7 @@
 
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include "afdo_printer.hpp"
 
@@ -48,11 +49,11 @@ std::string pretty_size(unsigned int size){
 /*!
  * \brief Print a file with a verbosity depending on the configuration. 
  * \param data The AFDO profile. 
- * \param vm The configuration. 
+ * \param config The configuration. 
  * \param file The file to print. 
  */
-void print_file(const gooda::afdo_data& data, boost::program_options::variables_map& vm, const std::string& file){
-    if(vm.count("debug")){
+void print_file(const gooda::afdo_data& data, const gooda::converter_config& config, const std::string& file){
+    if(config.debug){
         std::cout << file << "(" << data.get_file_index(file) << ")"; 
     } else {
         std::cout << file; 
@@ -61,7 +62,7 @@ void print_file(const gooda::afdo_data& data, boost::program_options::variables_
 
 } //end of anonymous namespace
 
-void gooda::dump_afdo(const afdo_data& data, const afdo_stack& stack, boost::program_options::variables_map& vm){
+void gooda::dump_afdo(const afdo_data& data, const afdo_stack& stack, const gooda::converter_config& config){
     if(stack.stack.empty()){
         std::cout << "   INVALID STACK of size " << stack.stack.size() 
             << ", with " << stack.num_inst << " dynamic instructions " 
@@ -71,7 +72,7 @@ void gooda::dump_afdo(const afdo_data& data, const afdo_stack& stack, boost::pro
             << ", with " << stack.num_inst << " dynamic instructions " 
             << "[count=" << stack.count;
 
-        if(vm.count("cache-misses")){
+        if(config.cache_misses){
             std::cout << ", cache-misses=" << stack.cache_misses;
         }
 
@@ -79,15 +80,15 @@ void gooda::dump_afdo(const afdo_data& data, const afdo_stack& stack, boost::pro
 
         for(auto& pos : stack.stack){
             std::cout << "      Instruction at ";
-            print_file(data, vm, pos.file);
+            print_file(data, config, pos.file);
             std::cout << ":" << pos.line << ", func=";
-            print_file(data, vm, pos.func);
+            print_file(data, config, pos.func);
             std::cout << ", discr=" << pos.discriminator << std::endl;
         }
     }
 }
 
-void gooda::dump_afdo(const afdo_data& data, boost::program_options::variables_map& vm){
+void gooda::dump_afdo(const afdo_data& data, const gooda::converter_config& config){
     std::cout << "The AFDO data contains " << data.functions.size() << " hotspot functions" << std::endl;
 
     std::cout << "Strings" << std::endl;
@@ -102,7 +103,7 @@ void gooda::dump_afdo(const afdo_data& data, boost::program_options::variables_m
     std::cout << "Hotspot functions" << std::endl;
     for(auto& function : functions) {
         std::cout << function.name << " (";
-        print_file(data, vm, function.file);
+        print_file(data, config, function.file);
         std::cout << ")" << " [" << function.total_count << ":" << function.entry_count << "]" << std::endl;
 
         auto stacks = function.stacks;
@@ -112,13 +113,13 @@ void gooda::dump_afdo(const afdo_data& data, boost::program_options::variables_m
                 });
 
         for(auto& stack : stacks){
-            dump_afdo(data, stack, vm);
+            dump_afdo(data, stack, config);
         }
 
         std::cout << std::endl;
     }
 
-    if(!vm.count("nows")){
+    if(config.working_set){
         std::cout << "Working Set" << std::endl;
         for(std::size_t i = 0; i < data.working_set.size(); ++i){
             std::cout << "   " << i << ": min= " << data.working_set[i].min_counter << " num= " << data.working_set[i].num_counter << std::endl;
@@ -132,7 +133,7 @@ void gooda::dump_afdo(const afdo_data& data, boost::program_options::variables_m
     std::cout << "   Working Set Table: " << pretty_size(data.length_working_set_section * 4) << std::endl;
 }
 
-void gooda::dump_afdo_light(const afdo_data& data, boost::program_options::variables_map& /*vm*/){
+void gooda::dump_afdo_light(const afdo_data& data, const gooda::converter_config& /*config*/){
     std::cout << "The AFDO data contains " << data.functions.size() << " hotspot functions" << std::endl;
 
     auto functions = data.functions;
@@ -37,9 +37,9 @@ void read_string_table(gooda::gcov_file& gcov_file, gooda::afdo_data& data){
  * \brief Read the function profile from the AFDO file. 
  * \param gcov_file The GCOV file to read from. 
  * \param data The AFDO profile to populate
- * \param vm The configuration
+ * \param config The configuration
  */
-void read_function_profile(gooda::gcov_file& gcov_file, gooda::afdo_data& data, boost::program_options::variables_map& vm){
+void read_function_profile(gooda::gcov_file& gcov_file, gooda::afdo_data& data, const gooda::converter_config& config){
     //AFDO TAG
     gcov_file.read_unsigned();
 
@@ -72,7 +72,7 @@ void read_function_profile(gooda::gcov_file& gcov_file, gooda::afdo_data& data,
             stack.count = gcov_file.read_counter();
             stack.num_inst = gcov_file.read_counter();
 
-            if(vm.count("cache-misses")){
+            if(config.cache_misses){
                 stack.cache_misses = gcov_file.read_counter();
             }
 
@@ -142,7 +142,7 @@ void read_working_set(gooda::gcov_file& gcov_file, gooda::afdo_data& data){
 
 } //end of anonymous
 
-void gooda::read_afdo(const std::string& afdo_file, gooda::afdo_data& data, boost::program_options::variables_map& vm){
+void gooda::read_afdo(const std::string& afdo_file, gooda::afdo_data& data, const gooda::converter_config& config){
     gooda::gcov_file gcov_file;
     gcov_file.open_for_read(afdo_file);
 
@@ -157,7 +157,7 @@ void gooda::read_afdo(const std::string& afdo_file, gooda::afdo_data& data, boos
 
     //Read the different sections
     read_string_table(gcov_file, data);
-    read_function_profile(gcov_file, data, vm);
+    read_function_profile(gcov_file, data, config);
     read_module_info(gcov_file, data);
     read_working_set(gcov_file, data);
 }
@@ -0,0 +1,174 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file build_id.cpp
+ * \brief Implementation of the extraction of the GNU build-id of ELF files.
+ */
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+
+#include <elf.h>
+
+#include "build_id.hpp"
+
+namespace {
+
+/*!
+ * \brief The maximal size of a note section that is read.
+ */
+const std::size_t MAX_NOTES_SIZE = 1024 * 1024;
+
+/*!
+ * \brief Align a size of a note on 4 bytes.
+ * \param size The size to align.
+ * \return The aligned size.
+ */
+inline std::size_t align_note(std::size_t size){
+    return (size + 3) & ~std::size_t(3);
+}
+
+/*!
+ * \brief Search the build-id in the notes at the given position of the file.
+ * \param stream The ELF file.
+ * \param offset The position of the notes in the file.
+ * \param size The size of the notes.
+ * \return The build-id as an hexadecimal string or an empty string if it is not in the notes.
+ */
+std::string search_notes(std::ifstream& stream, std::size_t offset, std::size_t size){
+    if(size > MAX_NOTES_SIZE){
+        return "";
+    }
+
+    std::vector<char> notes(size);
+
+    stream.clear();
+    stream.seekg(offset);
+
+    if(!stream.read(notes.data(), size)){
+        return "";
+    }
+
+    //The layout of the note header is the same in ELF32 and ELF64
+    std::size_t position = 0;
+    while(position + sizeof(Elf64_Nhdr) <= size){
+        Elf64_Nhdr header;
+        memcpy(&header, &notes[position], sizeof(header));
+
+        auto name = position + sizeof(header);
+        auto desc = name + align_note(header.n_namesz);
+        auto next = desc + align_note(header.n_descsz);
+
+        if(next > size){
+            break;
+        }
+
+        if(header.n_type == NT_GNU_BUILD_ID && header.n_namesz == 4 && memcmp(&notes[name], "GNU", 4) == 0){
+            static const char digits[] = "0123456789abcdef";
+
+            std::string id;
+            for(std::size_t i = desc; i < desc + header.n_descsz; ++i){
+                auto byte = static_cast<unsigned char>(notes[i]);
+                id += digits[byte >> 4];
+                id += digits[byte & 0xF];
+            }
+
+            return id;
+        }
+
+        position = next;
+    }
+
+    return "";
+}
+
+/*!
+ * \brief Search the build-id in the note sections and then in the note segments of the file.
+ * \param stream The ELF file.
+ * \tparam Ehdr The type of the ELF header.
+ * \tparam Shdr The type of the section headers.
+ * \tparam Phdr The type of the program headers.
+ * \return The build-id as an hexadecimal string or an empty string if the file has no build-id.
+ */
+template<typename Ehdr, typename Shdr, typename Phdr>
+std::string search_build_id(std::ifstream& stream){
+    Ehdr header;
+
+    stream.seekg(0);
+    if(!stream.read(reinterpret_cast<char*>(&header), sizeof(header))){
+        return "";
+    }
+
+    for(std::size_t i = 0; i < header.e_shnum && header.e_shentsize >= sizeof(Shdr); ++i){
+        Shdr section;
+
+        stream.clear();
+        stream.seekg(header.e_shoff + i * header.e_shentsize);
+        if(!stream.read(reinterpret_cast<char*>(&section), sizeof(section))){
+            break;
+        }
+
+        if(section.sh_type == SHT_NOTE){
+            auto id = search_notes(stream, section.sh_offset, section.sh_size);
+
+            if(!id.empty()){
+                return id;
+            }
+        }
+    }
+
+    //Stripped files may have no section headers
+    for(std::size_t i = 0; i < header.e_phnum && header.e_phentsize >= sizeof(Phdr); ++i){
+        Phdr segment;
+
+        stream.clear();
+        stream.seekg(header.e_phoff + i * header.e_phentsize);
+        if(!stream.read(reinterpret_cast<char*>(&segment), sizeof(segment))){
+            break;
+        }
+
+        if(segment.p_type == PT_NOTE){
+            auto id = search_notes(stream, segment.p_offset, segment.p_filesz);
+
+            if(!id.empty()){
+                return id;
+            }
+        }
+    }
+
+    return "";
+}
+
+} //end of anonymous namespace
+
+std::string gooda::build_id(const std::string& file){
+    std::ifstream stream(file, std::ios::in | std::ios::binary);
+
+    if(!stream){
+        return "";
+    }
+
+    unsigned char ident[EI_NIDENT];
+    if(!stream.read(reinterpret_cast<char*>(ident), EI_NIDENT) || memcmp(ident, ELFMAG, SELFMAG) != 0){
+        return "";
+    }
+
+    //Only the native little endian files are supported
+    if(ident[EI_DATA] != ELFDATA2LSB){
+        return "";
+    }
+
+    if(ident[EI_CLASS] == ELFCLASS64){
+        return search_build_id<Elf64_Ehdr, Elf64_Shdr, Elf64_Phdr>(stream);
+    } else if(ident[EI_CLASS] == ELFCLASS32){
+        return search_build_id<Elf32_Ehdr, Elf32_Shdr, Elf32_Phdr>(stream);
+    }
+
+    return "";
+}
@@ -10,11 +10,17 @@
  * \brief Implementation of the conversion from Gooda spreadsheets to AFDO profile.
  */
 
-#include <fstream>
-#include <sstream>
+#include <algorithm>
 #include <map>
+#include <iterator>
 #include <unordered_map>
 #include <utility>
+#include <memory>
+#include <limits>
+#include <cstdint>
+#include <cstdlib>
+
+#include <unistd.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -22,21 +28,234 @@
 #include "assert.hpp"
 #include "converter.hpp"
 #include "utils.hpp"
+#include "addr2line.hpp"
+#include "subprocess.hpp"
+#include "symbol_cache.hpp"
+#include "parallel.hpp"
 #include "logger.hpp"
 #include "hash.hpp"
+#include "flat_hash_map.hpp"
+#include "working_set.hpp"
+#include "gooda_reader.hpp"
+#include "perf_reader.hpp"
+#include "afdo_generator.hpp"
 #include "gooda_exception.hpp"
 
 namespace {
 
 /*!
- * \typedef address_key
+ * \struct address_key
  * \brief Identifies an instruction inside an ELF file by its address
  */
-typedef std::pair<std::string, std::string> address_key;
+struct address_key {
+    uint32_t executable;    //!< The interned id of the ELF file
+    uint64_t address;       //!< The address of the instruction
+
+    /*!
+     * \brief Compare two keys
+     * \param rhs The other key
+     * \return true if the keys are equal, false otherwise
+     */
+    bool operator==(const address_key& rhs) const {
+        return executable == rhs.executable && address == rhs.address;
+    }
+};
+
+/*!
+ * \struct address_key_hash
+ * \brief Hash functor for address_key
+ */
+struct address_key_hash {
+    /*!
+     * \brief Hash the key
+     * \param key The key to hash
+     * \return The hash value of the key
+     */
+    std::size_t operator()(const address_key& key) const {
+        return key.address ^ (static_cast<uint64_t>(key.executable) << 48);
+    }
+};
+
+/*!
+ * \struct inlined_stack
+ * \brief An inline stack reported by addr2line, with its precomputed hash
+ */
+struct inlined_stack {
+    std::vector<gooda::afdo_pos> positions;     //!< The positions of the stack, the innermost first
+    std::size_t hash;                           //!< The hash of the stack
+};
+
+/*!
+ * \brief The id of the executables that are not in the symbolization results
+ */
+const uint32_t UNKNOWN_EXECUTABLE = std::numeric_limits<uint32_t>::max();
+
+} //End of anonymous namespace
+
+struct gooda::symbolization_results {
+    std::unordered_map<std::string, uint32_t> executable_ids;                                       //!< The interned ELF files
+
+    gooda::flat_hash_map<address_key, inlined_stack, address_key_hash> inlining_cache;              //!< Inlining stack cache
+
+    gooda::flat_hash_map<address_key, gooda::afdo_pos, address_key_hash> discriminator_cache;       //!< Discriminator cache
+
+    /*!
+     * \brief Return the interned id of the given ELF file, assigning a new id the first time.
+     * \param executable_file The ELF file
+     * \return The id of the ELF file
+     */
+    uint32_t executable_id(const std::string& executable_file){
+        return executable_ids.emplace(executable_file, executable_ids.size()).first->second;
+    }
+
+    /*!
+     * \brief Return the interned id of the given ELF file.
+     * \param executable_file The ELF file
+     * \return The id of the ELF file, UNKNOWN_EXECUTABLE if it has no results
+     */
+    uint32_t find_executable(const std::string& executable_file) const {
+        auto it = executable_ids.find(executable_file);
+        return it == executable_ids.end() ? UNKNOWN_EXECUTABLE : it->second;
+    }
+};
+
+/*!
+ * \struct gooda::converter_context::impl
+ * \brief The state of a converter context.
+ */
+struct gooda::converter_context::impl {
+    std::shared_ptr<addr2line_pool> pool;                   //!< The addr2line processes
+    std::shared_ptr<const symbolization_results> shared;    //!< The shared symbolization results
+    std::shared_ptr<symbolization_results> symbols;         //!< The symbolization results of the context
+    converter_statistics statistics;                        //!< The statistics of the last conversion
+    std::shared_ptr<symbol_cache> cache;                    //!< The symbol cache kept between the conversions
+};
+
+gooda::converter_context::converter_context() : m_impl(new impl) {
+    m_impl->pool = std::make_shared<addr2line_pool>();
+    m_impl->symbols = std::make_shared<symbolization_results>();
+}
+
+gooda::converter_context::converter_context(std::shared_ptr<const symbolization_results> shared) : m_impl(new impl) {
+    m_impl->pool = std::make_shared<addr2line_pool>();
+    m_impl->shared = shared;
+    m_impl->symbols = std::make_shared<symbolization_results>();
+}
+
+gooda::converter_context::~converter_context() = default;
+
+std::shared_ptr<const gooda::symbolization_results> gooda::converter_context::results() const {
+    return m_impl->symbols;
+}
+
+const gooda::converter_statistics& gooda::converter_context::statistics() const {
+    return m_impl->statistics;
+}
+
+gooda::converter_statistics& gooda::converter_context::statistics(){
+    return m_impl->statistics;
+}
+
+void gooda::converter_context::reset(){
+    auto& symbols = m_impl->symbols;
+
+    //The results may still be read by other contexts
+    if(symbols.use_count() > 1){
+        symbols = std::make_shared<symbolization_results>();
+    } else {
+        symbols->executable_ids.clear();
+        symbols->inlining_cache.clear();
+        symbols->discriminator_cache.clear();
+    }
+
+    m_impl->statistics = converter_statistics();
+}
+
+gooda::addr2line_pool& gooda::converter_context::pool(){
+    return *m_impl->pool;
+}
+
+void gooda::converter_context::set_pool(std::shared_ptr<addr2line_pool> pool){
+    m_impl->pool = pool;
+}
+
+gooda::symbolization_results& gooda::converter_context::symbols(){
+    return *m_impl->symbols;
+}
+
+const gooda::symbolization_results* gooda::converter_context::shared_symbols() const {
+    return m_impl->shared.get();
+}
+
+void gooda::converter_context::set_symbol_cache(std::shared_ptr<symbol_cache> cache){
+    m_impl->cache = cache;
+}
+
+std::shared_ptr<gooda::symbol_cache> gooda::converter_context::get_symbol_cache() const {
+    return m_impl->cache;
+}
+
+namespace {
+
+/*!
+ * \struct executable_symbols
+ * \brief The symbolization results of one executable, in the results of the context and in the shared results
+ */
+struct executable_symbols {
+    const gooda::symbolization_results* own;        //!< The results of the context
+    uint32_t own_id;                                //!< The id of the executable in the results of the context
+    const gooda::symbolization_results* shared;     //!< The shared results, nullptr if there are none
+    uint32_t shared_id;                             //!< The id of the executable in the shared results
+    bool discriminators;                            //!< Indicates if the discriminators are used by the conversion
+
+    /*!
+     * \brief Return the inline stack of the given address
+     * \param address The address
+     * \return The inline stack of the address, nullptr if it is unknown
+     */
+    const inlined_stack* find_inlined(uint64_t address) const {
+        auto* entry = own->inlining_cache.find({own_id, address});
+        return entry || !shared ? entry : shared->inlining_cache.find({shared_id, address});
+    }
+
+    /*!
+     * \brief Return the discriminator position of the given address
+     * \param address The address
+     * \return The discriminator position of the address, nullptr if it is unknown or if the discriminators are not used
+     */
+    const gooda::afdo_pos* find_discriminator(uint64_t address) const {
+        //The shared results may come from a conversion with discriminators
+        if(!discriminators){
+            return nullptr;
+        }
+
+        auto* entry = own->discriminator_cache.find({own_id, address});
+        return entry || !shared ? entry : shared->discriminator_cache.find({shared_id, address});
+    }
+};
+
+/*!
+ * \brief Return the symbolization results of the given executable
+ * \param context The context of the conversion
+ * \param executable_file The ELF file
+ * \param discriminators Indicates if the discriminators are used by the conversion
+ * \return The symbolization results of the executable
+ */
+executable_symbols get_executable_symbols(gooda::converter_context& context, const std::string& executable_file, bool discriminators){
+    auto& own = context.symbols();
+    auto* shared = context.shared_symbols();
 
-std::unordered_map<address_key, std::vector<gooda::afdo_pos>> inlining_cache;   //!< Inlining stack cache
+    return {&own, own.find_executable(executable_file), shared, shared ? shared->find_executable(executable_file) : UNKNOWN_EXECUTABLE, discriminators};
+}
 
-std::unordered_map<address_key, gooda::afdo_pos> discriminator_cache;           //!< Discriminator cache
+/*!
+ * \brief Parse an hexadecimal address coming from the spreadsheets or from addr2line
+ * \param address The address to parse
+ * \return The numeric value of the address
+ */
+uint64_t parse_address(const std::string& address){
+    return strtoull(address.c_str(), nullptr, 16);
+}
 
 /*!
  * \struct gooda_bb
@@ -54,210 +273,571 @@ struct gooda_bb {
  */
 typedef std::vector<gooda_bb> bb_vector;
 
+/*!
+ * \typedef stack_index
+ * \brief Index of the stacks of the function being annotated, from the hash of a stack to its slot in the stacks of the function
+ */
+typedef std::unordered_multimap<std::size_t, std::size_t> stack_index;
+
+/*!
+ * \brief Hash a position from the hashes of its strings
+ * \param func_hash The hash of the function name
+ * \param file_hash The hash of the file name
+ * \param line The line
+ * \param discriminator The discriminator
+ * \return The hash of the position
+ */
+std::size_t hash_position(std::size_t func_hash, std::size_t file_hash, gcov_unsigned_t line, gcov_unsigned_t discriminator){
+    std::size_t seed = func_hash;
+
+    gooda::hash_combine(seed, file_hash);
+    gooda::hash_combine(seed, line);
+    gooda::hash_combine(seed, discriminator);
+
+    return seed;
+}
+
+/*!
+ * \brief Combine the hash of one more position of a stack into the hash of the stack
+ * \param seed The hash of the stack, initialized with its size
+ * \param position_hash The hash of the position
+ */
+inline void hash_stack(std::size_t& seed, std::size_t position_hash){
+    gooda::hash_combine(seed, position_hash);
+}
+
+/*!
+ * \brief Hash an inline stack
+ * \param positions The positions of the stack
+ * \return The hash of the stack
+ */
+std::size_t hash_stack(const std::vector<gooda::afdo_pos>& positions){
+    std::hash<std::string> hasher;
+
+    std::size_t seed = positions.size();
+
+    for(auto& pos : positions){
+        hash_stack(seed, hash_position(hasher(pos.func), hasher(pos.file), pos.line, pos.discriminator));
+    }
+
+    return seed;
+}
+
+/*!
+ * \brief Search an existing stack equal to the given positions
+ * \param function The AFDO function
+ * \param index The index of the stacks of the function
+ * \param positions The positions of the stack to search
+ * \param hash The hash of the positions
+ * \return A pointer to the equal stack, nullptr if there is none
+ */
+gooda::afdo_stack* find_stack(gooda::afdo_function& function, const stack_index& index, const std::vector<gooda::afdo_pos>& positions, std::size_t hash){
+    auto range = index.equal_range(hash);
+
+    for(auto it = range.first; it != range.second; ++it){
+        auto& stack = function.stacks[it->second];
+
+        if(stack.stack == positions){
+            return &stack;
+        }
+    }
+
+    return nullptr;
+}
+
+/*!
+ * \brief Add a new stack to the function and to the index
+ * \param function The AFDO function
+ * \param index The index of the stacks of the function
+ * \param positions The positions of the new stack
+ * \param hash The hash of the positions
+ * \return A reference to the new stack
+ */
+gooda::afdo_stack& add_stack(gooda::afdo_function& function, stack_index& index, std::vector<gooda::afdo_pos> positions, std::size_t hash){
+    index.emplace(hash, function.stacks.size());
+
+    gooda::afdo_stack stack;
+    stack.stack = std::move(positions);
+
+    function.stacks.push_back(std::move(stack));
+
+    return function.stacks.back();
+}
+
 /*!
  * \brief Get an inline stack for the given position.
  *
  * If the inline stack already exists, a reference to it is returned, else a new one is created.
  *
  * \param function The AFDO function
+ * \param index The index of the stacks of the function
  * \param position The afdo position to search for
+ * \param hash The hash of the stack made of the position
  * \return A reference to the corresponding inline stack
  */
-gooda::afdo_stack& get_stack(gooda::afdo_function& function, gooda::afdo_pos&& position){
+gooda::afdo_stack& get_stack(gooda::afdo_function& function, stack_index& index, gooda::afdo_pos&& position, std::size_t hash){
+    std::vector<gooda::afdo_pos> positions(1, std::move(position));
+
     //Try to find an equivalent stack
 
-    for(auto& stack : function.stacks){
-        if(stack.stack.size() == 1 && stack.stack.front() == position){
-            return stack;
-        }
+    if(auto* stack = find_stack(function, index, positions, hash)){
+        return *stack;
     }
 
     //If not found, create a new stack
 
-    gooda::afdo_stack stack;
-
-    stack.stack.push_back(std::move(position));
-
-    function.stacks.push_back(std::move(stack));
-
-    return function.stacks.back();
+    return add_stack(function, index, std::move(positions), hash);
 }
 
-gooda::afdo_stack fake_stack; //!< A fake stack used to return an empty stack
+const gooda::afdo_pos empty_position("", "", 0, 0); //!< The position of the addresses without discriminator
 
 /*!
  * \brief Get an inline stack for the given address that is coming from an inlined function
  * \param function The AFDO function
+ * \param index The index of the stacks of the function
+ * \param symbols The symbolization results of the executable of the function
  * \param address The address of the instruction
+ * \param fake_stack The stack to return when the address has no inline stack
  * \return A reference to the corresponding inline stack
  */
-gooda::afdo_stack& get_inlined_stack(gooda::afdo_function& function, std::string address){
-    auto key = std::make_pair(function.executable_file, address);
+gooda::afdo_stack& get_inlined_stack(gooda::afdo_function& function, stack_index& index, const executable_symbols& symbols, uint64_t address, gooda::afdo_stack& fake_stack){
+    auto* entry = symbols.find_inlined(address);
 
     //If the file does not exist, the cache will not be filled
     //It can also come from an error of addr2line
-    if(inlining_cache.find(key) == inlining_cache.end()){
-        log::emit<log::Warning>() << function.executable_file << ":" << address << " not in inlining cache" << log::endl;
+    if(!entry){
+        log::emit<log::Warning>() << function.executable_file << ":0x" << std::hex << address << std::dec << " not in inlining cache" << log::endl;
 
         return fake_stack;
     }
 
-    auto& vector = inlining_cache[key];
-
-    if(vector.empty()){
-        log::emit<log::Warning>() << function.executable_file << ":" << address << " indicated an empty inline stack" << log::endl;
+    if(entry->positions.empty()){
+        log::emit<log::Warning>() << function.executable_file << ":0x" << std::hex << address << std::dec << " indicated an empty inline stack" << log::endl;
 
         return fake_stack;
     }
 
     //Try to find an existing equivalent stack
 
-    for(auto& stack : function.stacks){
-        if(stack.stack.size() == vector.size()){
-            bool equals = true;
-            for(std::size_t i = 0; i < vector.size(); ++i){
-                if(stack.stack[i] != vector[i]){
-                    equals = false;
-                    break;
-                }
-            }
-
-            if(equals){
-                return stack;
-            }
-        }
+    if(auto* stack = find_stack(function, index, entry->positions, entry->hash)){
+        return *stack;
     }
 
     //If its not found, create a new stack
 
-    gooda::afdo_stack new_stack;
-    new_stack.stack.reserve(vector.size());
+    return add_stack(function, index, entry->positions, entry->hash);
+}
 
-    for(auto& pos : vector){
-        new_stack.stack.push_back(std::move(pos));
-    }
+/*!
+ * \struct asm_row
+ * \brief The typed data of one line of an assembly view
+ */
+struct asm_row {
+    uint64_t address = 0;               //!< The address of the instruction
+    unsigned long princ_line = 0;       //!< The line of the instruction in the principal file
+    unsigned long weight = 0;           //!< The counter of the instruction (cycles or instructions retired)
+    unsigned long latency = 0;          //!< The load latency of the instruction (only in cycle accounting)
+    bool has_address = false;           //!< Indicates if the line has an address
+    bool basic_block = false;           //!< Indicates if the line is a basic block header
+    bool inlined = false;               //!< Indicates if the instruction comes from an inlined function
+    bool valid_line = false;            //!< Indicates if princ_line has been parsed
+    bool valid_weight = false;          //!< Indicates if weight has been parsed
+    bool valid_latency = false;         //!< Indicates if latency has been parsed
+};
 
-    function.stacks.push_back(std::move(new_stack));
+/*!
+ * \struct function_view
+ * \brief The typed data of the assembly view of a function, extracted in a single sweep
+ */
+struct function_view {
+    std::string invalid;                                //!< The reason why the function is invalid, empty if it is valid
+    std::vector<asm_row> rows;                          //!< The typed lines of the view
+    bb_vector basic_blocks;                             //!< The basic blocks of the function
+    std::string file;                                   //!< The principal file of the function
+    gcov_type entry_count = 0;                          //!< The count of the entry basic block
+    std::string first_address;                          //!< The address of the first instruction
+    bool cpp = false;                                   //!< Indicates if the first instruction comes from a C++ file
+    std::vector<uint64_t> inlined_addresses;            //!< The addresses to symbolize for the inline stacks
+    std::vector<uint64_t> discriminator_addresses;      //!< The addresses to symbolize for the discriminators
+    double multiplex_weight = 0.0;                      //!< The multiplexing factor of the weight counter
+    double multiplex_latency = 0.0;                     //!< The multiplexing factor of the load latency counter
+    std::vector<double> counts;                         //!< The weighted counts of the instructions, for the working set
+};
 
-    return function.stacks.back();
+/*!
+ * \typedef function_views
+ * \brief The views of the converted functions, indexed by their index in the report
+ */
+typedef std::unordered_map<std::size_t, function_view> function_views;
+
+/*!
+ * \brief Parse a counter of a line, without throwing on invalid values.
+ * \param line The line
+ * \param column The column of the counter
+ * \param value The parsed counter
+ * \return true if the counter is valid, false otherwise
+ */
+bool parse_counter(const gooda::gooda_line& line, std::size_t column, unsigned long& value){
+    return boost::conversion::try_lexical_convert(line.get_string(column), value);
 }
 
 /*!
- * \brief Collect basic blocks of the given function
- * \param report The Gooda source report
- * \param function The AFDO function
- * \param lbr Indicate if lbr is activated or not
- * \return A vector containing all the basic blocks of the function
+ * \brief Throw an exception if a value needed by the conversion could not be parsed.
+ * \param valid Indicates if the value has been parsed.
+ * \param function The name of the function containing the value.
+ * \param what The name of the value.
+ */
+void check_parsed(bool valid, const std::string& function, const char* what){
+    if(!valid){
+        throw gooda::gooda_exception("Invalid " + std::string(what) + " in the assembly view of " + function);
+    }
+}
+
+/*!
+ * \struct cycles_policy
+ * \brief The counter policy of the cycle accounting mode.
+ *
+ * A counter policy defines the counters read from the assembly view and how the count of an
+ * instruction is merged into its stack. The sweep and the annotation are instantiated once per
+ * policy. A new policy only has to provide the same members.
+ */
+struct cycles_policy {
+    static const bool weighted = true;          //!< Indicates if the annotation uses the weight of the instructions
+    static const bool latency = true;           //!< Indicates if the annotation uses the load latency of the instructions
+    static const bool block_counts = false;     //!< Indicates if the annotation uses the execution count of the basic blocks
+
+    /*!
+     * \brief Return the counter weighting the instructions, also used for the working set.
+     * \return The name of the counter column.
+     */
+    static const char* weight_counter(){
+        return UNHALTED_CORE_CYCLES;
+    }
+
+    /*!
+     * \brief Return the count of the entry basic block.
+     * \param view The typed view of the function
+     * \param count The counter of the entry basic block
+     * \return The entry count of the function
+     */
+    static gcov_type entry_count(const function_view& view, unsigned long count){
+        return static_cast<gcov_type>(view.multiplex_weight * count);
+    }
+
+    /*!
+     * \brief Indicates if the counters of an instruction have been parsed.
+     * \param row The instruction
+     * \return true if the counters are valid, false otherwise
+     */
+    static bool valid(const asm_row& row){
+        return row.valid_weight && row.valid_latency;
+    }
+
+    /*!
+     * \brief Add an instruction to its stack. The cycles are summed and the highest latency is kept.
+     * \param stack The stack of the instruction
+     * \param view The typed view of the function
+     * \param row The instruction
+     */
+    static void add(gooda::afdo_stack& stack, const function_view& view, const asm_row& row, const gooda_bb&){
+        auto count = view.multiplex_weight * row.weight;
+        stack.count += static_cast<gcov_type>(count);
+
+        auto cache_misses = view.multiplex_latency * row.latency;
+        stack.cache_misses = std::max(stack.cache_misses, static_cast<gcov_type>(cache_misses));
+    }
+};
+
+/*!
+ * \struct lbr_policy
+ * \brief The counter policy of the LBR mode.
+ */
+struct lbr_policy {
+    static const bool weighted = false;         //!< Indicates if the annotation uses the weight of the instructions
+    static const bool latency = false;          //!< Indicates if the annotation uses the load latency of the instructions
+    static const bool block_counts = true;      //!< Indicates if the annotation uses the execution count of the basic blocks
+
+    /*!
+     * \brief Return the counter weighting the instructions, only used for the working set.
+     * \return The name of the counter column.
+     */
+    static const char* weight_counter(){
+        return SW_INST_RETIRED;
+    }
+
+    /*!
+     * \brief Return the count of the entry basic block.
+     * \param count The execution count of the entry basic block
+     * \return The entry count of the function
+     */
+    static gcov_type entry_count(const function_view&, unsigned long count){
+        return count;
+    }
+
+    /*!
+     * \brief Indicates if the counters of an instruction have been parsed.
+     * \return Always true, the basic block counts are checked by the sweep
+     */
+    static bool valid(const asm_row&){
+        return true;
+    }
+
+    /*!
+     * \brief Add an instruction to its stack. The stack is executed as many times as its most executed basic block.
+     * \param stack The stack of the instruction
+     * \param block The basic block of the instruction
+     */
+    static void add(gooda::afdo_stack& stack, const function_view&, const asm_row&, const gooda_bb& block){
+        stack.count = std::max(stack.count, block.exec_count);
+    }
+};
+
+/*!
+ * \brief Extract in a single sweep everything the conversion needs from the assembly view of a function.
+ *
+ * The sweep validates the principal file of the instructions, gathers the addresses to symbolize,
+ * builds the basic block table and parses the counters of each instruction. The sweep stops at
+ * the first invalid instruction. The counters needed by the conversion are checked only once
+ * the function is known to be valid.
+ *
+ * \param report The Gooda report
+ * \param i The index of the function in the report
+ * \param ws Indicate if the working set will be computed
+ * \tparam Policy The counter policy
+ * \return The typed view of the function
  */
-bb_vector collect_basic_blocks(const gooda::gooda_report& report, gooda::afdo_function& function, bool lbr){
-    bb_vector basic_blocks;
-    basic_blocks.reserve(10);
+template<typename Policy>
+function_view sweep_function(const gooda::gooda_report& report, std::size_t i, bool ws){
+    function_view view;
+
+    auto& file = report.asm_file(i);
+
+    bool valid_multiplex = true;    //false if a needed multiplexing factor cannot be parsed
+    bool valid_counts = true;       //false if a basic block count cannot be parsed
+
+    auto address_column = file.column(ADDRESS);
+    auto disassembly_column = file.column(DISASSEMBLY);
+    auto princ_file_column = file.column(PRINC_FILE);
+    auto princ_line_column = file.column(PRINC_LINE);
+    auto init_file_column = file.column(INIT_FILE);
+    auto init_line_column = file.column(INIT_LINE);
 
-    auto& file = report.asm_file(function.i);
+    //The weight is needed by the annotation of some policies and by the working set
+    bool weight = Policy::weighted || ws;
+    std::size_t weight_column = 0;
+    std::size_t latency_column = 0;
+    std::size_t exec_column = 0;
+
+    if(weight){
+        weight_column = file.column(Policy::weight_counter());
+
+        valid_multiplex = boost::conversion::try_lexical_convert(file.multiplex_line().get_string(weight_column), view.multiplex_weight);
+    }
+
+    if(Policy::latency){
+        latency_column = file.column(LOAD_LATENCY);
+
+        valid_multiplex = valid_multiplex && boost::conversion::try_lexical_convert(file.multiplex_line().get_string(latency_column), view.multiplex_latency);
+    }
+
+    if(Policy::block_counts){
+        exec_column = file.column(BB_EXEC);
+    }
 
     //Compute the addresses of the first and the last instructions
-    auto start_instruction = report.hotspot_function(function.i).get_address(report.get_hotspot_file().column(OFFSET));
-    auto length = report.hotspot_function(function.i).get_address(report.get_hotspot_file().column(LENGTH));
+    auto start_instruction = report.hotspot_function(i).get_address(report.get_hotspot_file().column(OFFSET));
+    auto length = report.hotspot_function(i).get_address(report.get_hotspot_file().column(LENGTH));
     auto last_instruction = start_instruction + length;
-    bool bb_found = false;
+
+    bool collecting = true;         //false once the basic blocks of the function have all been found
+    bool bb_found = false;          //true on the line following the entry basic block
+    std::size_t open_block = 0;     //The number of basic blocks whose end is known
+
+    view.rows.resize(file.lines());
 
     for(std::size_t j = 0; j < file.lines(); ++j){
         auto& line = file.line(j);
+        auto& row = view.rows[j];
+
+        auto address = line.get_string(address_column);
+        auto disassembly = line.get_string(disassembly_column);
+
+        row.has_address = !address.empty();
+        row.address = row.has_address ? parse_address(address) : 0;
+        row.basic_block = boost::starts_with(disassembly, "Basic Block");
 
-        //It indicates the last line, that is not a valid assembly line but a summary of the data
-        if(line.get_string(file.column(ADDRESS)).empty()){
-            return basic_blocks;
+        //A basic block ends at the next basic block
+        if(row.basic_block){
+            while(open_block < view.basic_blocks.size()){
+                view.basic_blocks[open_block++].gooda_line_end = j;
+            }
         }
 
-        auto disassembly = line.get_string(file.column(DISASSEMBLY));
+        std::string princ_file;
 
-        //Collect Basic Block informations
-        if(boost::starts_with(disassembly, "Basic Block ")){
-            gooda_bb block;
+        if(row.has_address && !row.basic_block){
+            //Gooda does not always found the source file of a function
+            //In that case, declare the function as invalid and return quickly
+            princ_file = line.get_string(princ_file_column);
 
-            if(lbr){
-                block.exec_count = line.get_counter(file.column(BB_EXEC));
+            if(princ_file == "null"){
+                view.invalid = "null file";
+                return view;
             }
 
-            //Compute the start and end line
-            block.gooda_line_start = j;
+            if(princ_file.empty()){
+                view.invalid = "empty file";
+                return view;
+            }
+
+            if(view.first_address.empty()){
+                view.first_address = address;
+                view.cpp = boost::ends_with(princ_file, ".cpp");
+            }
 
-            auto k = j+1;
-            while(k < file.lines() - 1 && !boost::starts_with(file.line(k).get_string(file.column(DISASSEMBLY)), "Basic Block")){
-                k++;
+            row.valid_line = parse_counter(line, princ_line_column, row.princ_line);
+
+            if(weight){
+                row.valid_weight = parse_counter(line, weight_column, row.weight);
+            }
+
+            if(Policy::latency){
+                row.valid_latency = parse_counter(line, latency_column, row.latency);
             }
+        }
+
+        //Collect the addresses to symbolize
+
+        if(row.has_address && !line.get_string(init_line_column).empty()){
+            view.inlined_addresses.push_back(row.address);
+        }
+
+        row.inlined = !line.get_string(init_file_column).empty();
+
+        if(row.has_address && !row.inlined){
+            view.discriminator_addresses.push_back(row.address);
+        }
+
+        //Collect the basic blocks, until the summary line or the end of the function
+
+        if(!collecting){
+            continue;
+        }
+
+        if(!row.has_address){
+            collecting = false;
+            continue;
+        }
+
+        if(boost::starts_with(disassembly, "Basic Block ")){
+            gooda_bb block;
+            block.exec_count = 0;
+            block.gooda_line_start = j;
+            block.gooda_line_end = j;
 
-            block.gooda_line_end = k == file.lines() ? k - 1 : k;
+            if(Policy::block_counts){
+                valid_counts = valid_counts && parse_counter(line, exec_column, block.exec_count);
+            }
 
-            basic_blocks.push_back(std::move(block));
+            view.basic_blocks.push_back(block);
         }
 
         //Get the entry basic block and the function file
         if(boost::starts_with(disassembly, "Basic Block 1 ")){
-            if(lbr){
-                function.entry_count = line.get_counter(file.column(BB_EXEC));
-            } else {
-                auto count = file.multiplex_line().get_double(file.column(UNHALTED_CORE_CYCLES)) * line.get_counter(file.column(UNHALTED_CORE_CYCLES));
-                function.entry_count = static_cast<gcov_type>(count);
-            }
+            unsigned long count = 0;
+            valid_counts = valid_counts && parse_counter(line, Policy::block_counts ? exec_column : weight_column, count);
+
+            view.entry_count = Policy::entry_count(view, count);
 
             bb_found = true;
         } else if(bb_found){
-            function.file = line.get_string(file.column(PRINC_FILE));
+            view.file = princ_file.empty() ? line.get_string(princ_file_column) : princ_file;
 
             bb_found = false;
         }
 
-        auto address = line.get_address(file.column(ADDRESS));
-        if(address != start_instruction && address >= last_instruction){
-            break;
+        if(row.address != static_cast<uint64_t>(start_instruction) && row.address >= static_cast<uint64_t>(last_instruction)){
+            collecting = false;
         }
     }
 
-    gooda_assert(!function.file.empty(), "The function file must be set");
+    //The last basic block ends at the last line
+    while(open_block < view.basic_blocks.size()){
+        view.basic_blocks[open_block++].gooda_line_end = file.lines() - 1;
+    }
+
+    if(!valid_multiplex || !valid_counts){
+        auto name = report.hotspot_function(i).get_string(report.get_hotspot_file().column(FUNCTION_NAME));
 
-    return basic_blocks;
+        check_parsed(valid_multiplex, name, "multiplexing factor");
+        check_parsed(valid_counts, name, "basic block count");
+    }
+
+    return view;
 }
 
 /*!
- * \brief Annotate the function with Unhalted Core Cycles counters
- * \param report The Gooda source report
+ * \brief Annotate the function with the counters of the given policy
  * \param function The AFDO function
- * \param basic_blocks The basic blocks
+ * \param view The typed view of the function
+ * \param symbols The symbolization results of the executable of the function
+ * \param statistics The statistics of the conversion
+ * \tparam Policy The counter policy
  */
-void ca_annotate(const gooda::gooda_report& report, gooda::afdo_function& function, bb_vector& basic_blocks){
-    auto& asm_file = report.asm_file(function.i);
+template<typename Policy>
+void annotate(gooda::afdo_function& function, const function_view& view, const executable_symbols& symbols, gooda::converter_statistics& statistics){
+    stack_index index;
+
+    //The counts of the instructions without inline stack are not kept
+    gooda::afdo_stack fake_stack;
+
+    std::hash<std::string> hasher;
+    auto name_hash = hasher(function.name);
+    auto file_hash = hasher(function.file);
 
-    for(auto& block : basic_blocks){
+    for(auto& block : view.basic_blocks){
         for(auto j = block.gooda_line_start + 1; j < block.gooda_line_end; ++j){
-            gooda_assert(j < asm_file.lines(), "Something went wrong with BB collection");
+            gooda_assert(j < view.rows.size(), "Something went wrong with BB collection");
 
-            auto& asm_line = asm_file.line(j);
+            auto& row = view.rows[j];
 
-            auto& filled_entry = discriminator_cache[{function.executable_file, asm_line.get_string(asm_file.column(ADDRESS))}];
+            auto* cached_entry = symbols.find_discriminator(row.address);
+            auto& filled_entry = cached_entry ? *cached_entry : empty_position;
 
             auto discriminator = filled_entry.discriminator;
 
             std::string file_name;
+            std::size_t file_name_hash;
             gcov_unsigned_t line_number;
 
             if(filled_entry.file.empty()){
-                line_number = asm_line.get_counter(asm_file.column(PRINC_LINE));
+                check_parsed(row.valid_line, function.name, "line number");
+
+                line_number = row.princ_line;
                 file_name = function.file;
+                file_name_hash = file_hash;
             } else {
                 line_number = filled_entry.line;
                 file_name = filled_entry.file;
+                file_name_hash = hasher(file_name);
+            }
+
+            std::size_t hash = 1;
+            hash_stack(hash, hash_position(name_hash, file_name_hash, line_number, discriminator));
+
+            auto& stack = !row.inlined
+                ? get_stack(function, index, {function.name, file_name, line_number, discriminator}, hash)
+                : get_inlined_stack(function, index, symbols, row.address, fake_stack);
+
+            if(&stack == &fake_stack){
+                ++statistics.missing_stacks;
             }
 
-            auto& stack = asm_line.get_string(asm_file.column(INIT_FILE)).empty()
-                ? get_stack(function, {function.name, file_name, line_number, discriminator})
-                : get_inlined_stack(function, asm_line.get_string(asm_file.column(ADDRESS)));
+            ++statistics.instructions;
 
-            auto count = asm_file.multiplex_line().get_double(asm_file.column(UNHALTED_CORE_CYCLES)) * asm_line.get_counter(asm_file.column(UNHALTED_CORE_CYCLES));
-            stack.count += static_cast<gcov_type>(count);
+            check_parsed(Policy::valid(row), function.name, "counter");
 
-            auto cache_misses = asm_file.multiplex_line().get_double(asm_file.column(LOAD_LATENCY)) * asm_line.get_counter(asm_file.column(LOAD_LATENCY));
-            stack.cache_misses = std::max(stack.cache_misses, static_cast<gcov_type>(cache_misses));
+            Policy::add(stack, view, row, block);
 
             //There is one more dynamic instruction
             ++stack.num_inst;
@@ -266,55 +846,13 @@ void ca_annotate(const gooda::gooda_report& report, gooda::afdo_function& functi
 }
 
 /*!
- * \brief Annotate the function with LBR counters
- * \param report The Gooda source report
- * \param function The AFDO function
- * \param basic_blocks The basic blocks
+ * \brief Return the AFDO size of the given string
+ * \param str The string to get the size of.
+ * \return The AFDO size of the given string.
  */
-void lbr_annotate(const gooda::gooda_report& report, gooda::afdo_function& function, bb_vector& basic_blocks){
-    auto& asm_file = report.asm_file(function.i);
-
-    for(auto& block : basic_blocks){
-        for(auto j = block.gooda_line_start + 1; j < block.gooda_line_end; ++j){
-            gooda_assert(j < asm_file.lines(), "Something went wrong with BB collection");
-
-            auto& asm_line = asm_file.line(j);
-
-            auto& filled_entry = discriminator_cache[{function.executable_file, asm_line.get_string(asm_file.column(ADDRESS))}];
-
-            auto discriminator = filled_entry.discriminator;
-
-            std::string file_name;
-            gcov_unsigned_t line_number;
-
-            if(filled_entry.file.empty()){
-                line_number = asm_line.get_counter(asm_file.column(PRINC_LINE));
-                file_name = function.file;
-            } else {
-                line_number = filled_entry.line;
-                file_name = filled_entry.file;
-            }
-
-            auto& stack = asm_line.get_string(asm_file.column(INIT_FILE)).empty()
-                ? get_stack(function, {function.name, file_name, line_number, discriminator})
-                : get_inlined_stack(function, asm_line.get_string(asm_file.column(ADDRESS)));
-
-            stack.count = std::max(stack.count, block.exec_count);
-
-            //There is one more dynamic instruction
-            ++stack.num_inst;
-        }
-    }
-}
-
-/*!
- * \brief Return the AFDO size of the given string
- * \param str The string to get the size of.
- * \return The AFDO size of the given string.
- */
-unsigned int sizeof_string(const std::string& str){
-    return 1 + (str.length() + sizeof(gcov_unsigned_t)) / sizeof(gcov_unsigned_t);
-}
+unsigned int sizeof_string(const std::string& str){
+    return 1 + (str.length() + sizeof(gcov_unsigned_t)) / sizeof(gcov_unsigned_t);
+}
 
 /*!
  * \brief Compute the length of each section of the AFDO data file.
@@ -366,77 +904,18 @@ void compute_lengths(gooda::afdo_data& data){
 }
 
 /*!
- * \brief Compute the working set for the given data.
- * \param report The Gooda report
+ * \brief Collect the counts of the instructions of the given data, collected during the annotation, for the working set.
+ * \param views The typed views of the functions
  * \param data the AFDO profile
- * \param vm The configuration
- * \param lbr Indicate the mode.
+ * \param counts The vector receiving the count of each instruction
+ * \param total_count The sum of the counts
  */
-void compute_working_set(const gooda::gooda_report& report, gooda::afdo_data& data, boost::program_options::variables_map& vm, bool lbr){
-    //Fill the working set with zero
-    for(auto& working_set : data.working_set){
-        working_set.num_counter = 0;
-        working_set.min_counter = 0;
-    }
-
-    //Let it be zero if the user does not want it
-    if(vm.count("nows")){
-        return;
-    }
-
-    std::map<uint64_t, uint64_t> histogram;
-    uint64_t total_count = 0;
-
-    auto counter = lbr ? SW_INST_RETIRED : UNHALTED_CORE_CYCLES;
-
+void collect_working_set(const function_views& views, const gooda::afdo_data& data, std::vector<uint64_t>& counts, uint64_t& total_count){
     for(auto& function : data.functions){
-        auto& asm_file = report.asm_file(function.i);
-
-        for(std::size_t j = 0; j < asm_file.lines(); ++j){
-            auto& asm_line = asm_file.line(j);
-
-            if(!asm_line.get_string(asm_file.column(ADDRESS)).empty() && !boost::starts_with(asm_line.get_string(asm_file.column(DISASSEMBLY)), "Basic Block")){
-                auto count = asm_file.multiplex_line().get_double(asm_file.column(counter)) * asm_line.get_counter(asm_file.column(counter));
-
-                histogram[count]++;
-                total_count += count;
-            }
-        }
-    }
-
-    auto rit = histogram.rbegin();
-    auto rend = histogram.rend();
-
-    unsigned int bucket_num = 0;
-    uint64_t accumulated_count = 0;
-    uint64_t accumulated_inst = 0;
-    uint64_t one_bucket_count = total_count / (gooda::WS_SIZE + 1);
-
-    while(rit != rend && bucket_num < gooda::WS_SIZE){
-        uint64_t count = rit->first;
-        uint64_t num_inst = rit->second;
-
-        while(count * num_inst + accumulated_count > one_bucket_count * (bucket_num + 1)){
-            int offset = (one_bucket_count * (bucket_num + 1) - accumulated_count) / count;
-
-            accumulated_inst += offset;
-            accumulated_count += offset * count;
-
-            num_inst -= offset;
-
-            if(bucket_num >= gooda::WS_SIZE){
-                break;
-            }
-
-            data.working_set.at(bucket_num).num_counter = accumulated_inst;
-            data.working_set.at(bucket_num).min_counter = count;
-            ++bucket_num;
+        for(auto count : views.at(function.i).counts){
+            counts.push_back(count);
+            total_count += count;
         }
-
-        accumulated_inst += num_inst;
-        accumulated_count += num_inst * count;
-
-        ++rit;
     }
 }
 
@@ -453,12 +932,12 @@ std::string get_application_file(const gooda::gooda_report& report, std::size_t
 /*!
  * \brief Return the process filter
  * \param report the report to fill.
- * \param vm The configuration.
+ * \param config The configuration.
  * \param counter_name The name of the counter.
  * \return the process filter
  */
-std::string get_process_filter(const gooda::gooda_report& report, boost::program_options::variables_map& vm, std::string& counter_name){
-    if(vm.count("filter")){
+std::string get_process_filter(const gooda::gooda_report& report, const gooda::converter_config& config, std::string& counter_name){
+    if(config.filter){
         std::string max_process = "";
         std::size_t max_value = 0;
 
@@ -481,243 +960,364 @@ std::string get_process_filter(const gooda::gooda_report& report, boost::program
         }
 
         return max_process;
-    } else if(vm.count("process")){
-        return vm["process"].as<std::string>();
+    } else if(!config.process.empty()){
+        return config.process;
     } else {
         return "";
     }
 }
 
 /*!
- * \brief Extract the address from a line coming from addr2line
- * \param str_line The line to parse
- * \return The address is Gooda format
+ * \brief Parse a location line coming from addr2line.
+ * \param str_line The line to parse, in the "file:line (discriminator d)" form
+ * \param file_name The parsed file name
+ * \param line_number The parsed line number, "?" if unknown
+ * \param discriminator The parsed discriminator, 0 if not present
  */
-std::string extract_address(const std::string& str_line){
-    std::string address = "0x";
+void parse_location(const std::string& str_line, std::string& file_name, std::string& line_number, gcov_unsigned_t& discriminator){
+    auto start_disc = str_line.find("(discriminator ");
+    auto start_number = str_line.rfind(":");
+
+    if(start_disc == std::string::npos){
+        line_number = str_line.substr(start_number + 1, str_line.size() - start_number - 1);
+        file_name = str_line.substr(0, start_number);
+        discriminator = 0;
+    } else {
+        line_number = str_line.substr(start_number + 1, start_disc - start_number - 2);
+        file_name = str_line.substr(0, start_number);
 
-    int i = 2;
-    while(str_line[i] == '0'){
-        ++i;
+        auto end = str_line.find(")", start_disc);
+        auto discriminator_str = str_line.substr(start_disc + 15, end - start_disc - 15);
+        discriminator = boost::lexical_cast<gcov_unsigned_t>(discriminator_str);
     }
+}
 
-    address += str_line.substr(i, str_line.size() - i);
+/*!
+ * \typedef address_sets
+ * \brief The addresses to query, grouped by executable file, in a deterministic order
+ */
+typedef std::map<std::string, std::vector<std::string>> address_sets;
 
-    return address;
-}
+/*!
+ * \typedef address_values
+ * \brief The numeric addresses to query, grouped by executable file
+ */
+typedef std::map<std::string, std::vector<uint64_t>> address_values;
 
 /*!
- * \brief Fill the inlining cache
- * \param report The gooda report to fill
- * \param data The data already filled
- * \param vm The configuration
+ * \struct address_shard
+ * \brief A contiguous range of the sorted addresses of one executable, resolved by one worker
  */
-void fill_inlining_cache(const gooda::gooda_report& report, gooda::afdo_data& data, boost::program_options::variables_map& vm){
-    std::unordered_map<std::string, std::vector<std::string>> addresses;
+struct address_shard {
+    address_sets::const_iterator executable;    //!< The executable and its addresses
+    std::size_t first;                          //!< The index of the first address of the shard
+    std::size_t last;                           //!< The index one past the last address of the shard
+};
 
-    //Collect the inlined addresses
+/*!
+ * \brief The minimal number of addresses of a shard. Each shard starts its own addr2line process
+ * that has to load the DWARF information, so small shards are not worth it.
+ */
+const std::size_t MIN_SHARD_SIZE = 2048;
 
-    for(auto& function : data.functions){
-        auto& file = report.asm_file(function.i);
+/*!
+ * \brief Sort and deduplicate the addresses of each executable and split them into shards.
+ *
+ * The addresses are sorted by increasing value, so that addr2line walks the line table and
+ * the inline trees monotonically and resolves each address once. The addresses of an
+ * executable are split into at most jobs contiguous shards of at least MIN_SHARD_SIZE
+ * addresses. The shards are ordered by executable and by address.
+ *
+ * \param values The addresses to query
+ * \param sets The formatted addresses, referenced by the shards
+ * \param jobs The number of threads
+ * \return The shards
+ */
+std::vector<address_shard> make_shards(address_values& values, address_sets& sets, std::size_t jobs){
+    std::vector<address_shard> shards;
 
-        for(std::size_t j = 0; j < file.lines(); ++j){
-            auto& line = file.line(j);
+    for(auto& executable : values){
+        auto& numbers = executable.second;
 
-            if(!line.get_string(file.column(INIT_LINE)).empty()){
-                addresses[function.executable_file].push_back(line.get_string(file.column(ADDRESS)));
-            }
+        if(numbers.empty()){
+            continue;
+        }
+
+        std::sort(numbers.begin(), numbers.end());
+        numbers.erase(std::unique(numbers.begin(), numbers.end()), numbers.end());
+
+        auto& addresses = sets[executable.first];
+        addresses.reserve(numbers.size());
+
+        for(auto address : numbers){
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "0x%llx", static_cast<unsigned long long>(address));
+            addresses.emplace_back(buffer);
         }
     }
 
-    //Fill the inlining cache by using addr2line
+    for(auto it = sets.cbegin(); it != sets.cend(); ++it){
+        auto& addresses = it->second;
 
-    for(auto& address_set : addresses){
-        auto file = address_set.first;
+        std::size_t n = std::max(std::size_t(1), std::min(jobs, addresses.size() / MIN_SHARD_SIZE));
 
-        if(!vm["folder"].as<std::string>().empty()){
-            file = vm["folder"].as<std::string>() + "/" + file;
+        for(std::size_t s = 0; s < n; ++s){
+            shards.push_back({it, s * addresses.size() / n, (s + 1) * addresses.size() / n});
         }
+    }
+
+    return shards;
+}
+
+/*!
+ * \brief Query addr2line for each shard of addresses, the shards being resolved concurrently.
+ *
+ * The functor is called with the index of the shard, the address and its frames. It can be
+ * called concurrently for different shards. The addresses found in the symbol cache are given
+ * first, then the resolved ones, each in the order of the addresses of the shard.
+ *
+ * \param shards The shards to query
+ * \param config The configuration
+ * \param pool The addr2line processes
+ * \param cache The symbol cache, nullptr if disabled
+ * \param label The label of the query in the logs
+ * \param functor The functor to call for each resolved address
+ */
+template<typename Functor>
+void query_addr2line(const std::vector<address_shard>& shards, const gooda::converter_config& config, gooda::addr2line_pool& pool, gooda::symbol_cache* cache, const std::string& label, Functor functor){
+    auto folder = config.folder;
+    auto addr2line = config.addr2line;
+
+    gooda::parallel_for_each(shards.size(), gooda::thread_count(config.jobs), [&](std::size_t i){
+        auto& shard = shards[i];
+        auto& addresses = shard.executable->second;
+        auto file = gooda::executable_path(shard.executable->first, folder);
 
         if(!gooda::exists(file)){
-            log::emit<log::Warning>() << "File " << file << " does not exist" << log::endl;
+            if(shard.first == 0){
+                log::emit<log::Warning>() << "File " << file << " does not exist" << log::endl;
+            }
 
-            continue;
+            return;
+        }
+
+        auto first = addresses.begin() + shard.first;
+        auto last = addresses.begin() + shard.last;
+
+        auto id = cache ? cache->build_id(file) : std::string();
+
+        if(id.empty()){
+            log::emit<log::Debug>() << label << " " << file << " with " << addr2line << " [" << shard.first << ", " << shard.last << ")" << log::endl;
+
+            pool.query(addr2line, file, first, last,
+                [&functor, i](const std::string& address, std::vector<gooda::addr2line_frame>& frames){
+                    functor(i, address, frames);
+                });
+
+            return;
         }
 
-        log::emit<log::Debug>() << "Query " << file << " with " << vm["addr2line"].as<std::string>() << log::endl;
+        std::vector<gooda::symbol_frames> hits;
+        std::vector<std::string> misses;
+        cache->lookup_frames(id, first, last, hits, misses);
 
-        std::ofstream address_file;
-        address_file.open("addresses", std::ios::out );
+        log::emit<log::Debug>() << label << " " << file << " with " << addr2line << " [" << shard.first << ", " << shard.last << ") "
+            << hits.size() << " cached" << log::endl;
 
-        for(auto& address : address_set.second){
-            address_file << address << " ";
+        for(auto& hit : hits){
+            functor(i, hit.first, hit.second);
         }
 
-        address_file << std::endl;
+        if(!misses.empty()){
+            std::vector<gooda::symbol_frames> resolved;
+
+            pool.query(addr2line, file, misses.cbegin(), misses.cend(),
+                [&functor, &resolved, i](const std::string& address, std::vector<gooda::addr2line_frame>& frames){
+                    resolved.emplace_back(address, frames);
+                    functor(i, address, frames);
+                });
+
+            cache->store_frames(id, resolved);
+        }
+    });
+}
 
-        auto command = vm["addr2line"].as<std::string>() + " -f -a -i --exe=" + file + " @addresses";
-        log::emit<log::Trace>() << "Run command \"" << command << "\"" << log::endl;
-        auto result = gooda::exec_command_result(command);
+/*!
+ * \brief Fill the inlining cache
+ * \param views The typed views of the functions
+ * \param data The data already filled
+ * \param config The configuration
+ * \param context The context of the conversion
+ * \param cache The symbol cache, nullptr if disabled
+ */
+void fill_inlining_cache(const function_views& views, gooda::afdo_data& data, const gooda::converter_config& config, gooda::converter_context& context, gooda::symbol_cache* cache){
+    auto& symbols = context.symbols();
+    auto& statistics = context.statistics();
 
-        remove("addresses");
+    address_values values;
 
-        std::istringstream result_stream(result);
-        std::string str_line;
+    //Collect the inlined addresses, except the ones already in the shared results
 
-        std::string address;
+    for(auto& function : data.functions){
+        auto shared = get_executable_symbols(context, function.executable_file, config.discriminators);
+        auto& executable_values = values[function.executable_file];
 
-        while (std::getline(result_stream, str_line)) {
-            if(boost::starts_with(str_line, "0x000000")){
-                address = extract_address(str_line);
+        for(auto address : views.at(function.i).inlined_addresses){
+            if(shared.shared && shared.shared->inlining_cache.find({shared.shared_id, address})){
+                ++statistics.shared_addresses;
             } else {
-                auto key = std::make_pair(address_set.first, address);
+                executable_values.push_back(address);
+            }
+        }
+    }
 
-                auto function_name = str_line;
+    //Get the inline stacks by using addr2line
 
-                std::getline(result_stream, str_line);
+    address_sets addresses;
+    auto shards = make_shards(values, addresses, gooda::thread_count(config.jobs));
 
-                std::string file_name;
-                std::string line_number;
-                gcov_unsigned_t discriminator;
+    for(auto& shard : shards){
+        statistics.symbolized_addresses += shard.last - shard.first;
+    }
 
-                auto start_disc = str_line.find("(discriminator ");
-                auto start_number = str_line.rfind(":");
+    std::vector<std::vector<std::pair<std::string, std::vector<gooda::afdo_pos>>>> results(shards.size());
 
-                if(start_disc == std::string::npos){
-                    line_number = str_line.substr(start_number + 1, str_line.size() - start_number - 1);
-                    file_name = str_line.substr(0, start_number);
-                    discriminator = 0;
-                } else {
-                    line_number = str_line.substr(start_number + 1, start_disc - start_number - 2);
-                    file_name = str_line.substr(0, start_number);
+    query_addr2line(shards, config, context.pool(), cache, "Query", [&results](std::size_t i, const std::string& address, std::vector<gooda::addr2line_frame>& frames){
+        std::vector<gooda::afdo_pos> stack;
 
-                    auto end = str_line.find(")", start_disc);
-                    auto discriminator_str = str_line.substr(start_disc + 15, end - start_disc - 15);
-                    discriminator = boost::lexical_cast<gcov_unsigned_t>(discriminator_str);
-                }
+        for(auto& frame : frames){
+            std::string file_name;
+            std::string line_number;
+            gcov_unsigned_t discriminator;
 
-                if(line_number != "?"){
-                    inlining_cache[key].emplace_back(function_name, file_name, boost::lexical_cast<gcov_unsigned_t>(line_number), discriminator);
-                }
+            parse_location(frame.location, file_name, line_number, discriminator);
+
+            if(line_number != "?"){
+                stack.emplace_back(frame.function, file_name, boost::lexical_cast<gcov_unsigned_t>(line_number), discriminator);
             }
         }
+
+        if(!stack.empty()){
+            results[i].emplace_back(address, std::move(stack));
+        }
+    });
+
+    //Fill the inlining cache, in the order of the shards
+
+    for(std::size_t i = 0; i < shards.size(); ++i){
+        for(auto& result : results[i]){
+            symbols.inlining_cache[{symbols.executable_id(shards[i].executable->first), parse_address(result.first)}].positions = std::move(result.second);
+        }
     }
 
     //There is a bug in addr2line 2.23.1 that gives discriminator for each element of the inlining stack
     //However, only the one from the source is valid. DWARF does not allow discriminators in the inline stack
     //Thus, it is necessary to clear the others lines
 
-    for(auto& inlining_entry : inlining_cache){
-        auto& inlining_stack = inlining_entry.second;
-        for(std::size_t i = 1; i < inlining_stack.size(); ++i){
-            inlining_stack.at(i).discriminator = 0;
+    symbols.inlining_cache.for_each([](const address_key&, inlined_stack& inlining_stack){
+        for(std::size_t i = 1; i < inlining_stack.positions.size(); ++i){
+            inlining_stack.positions.at(i).discriminator = 0;
         }
-    }
+
+        inlining_stack.hash = hash_stack(inlining_stack.positions);
+    });
 }
 
 /*!
  * \brief Fill the discriminator cache
- * \param report The gooda report to fill
+ * \param views The typed views of the functions
  * \param data The data already filled
- * \param vm The configuration
+ * \param config The configuration
+ * \param context The context of the conversion
+ * \param cache The symbol cache, nullptr if disabled
  */
-void fill_discriminator_cache(const gooda::gooda_report& report, gooda::afdo_data& data, boost::program_options::variables_map& vm){
-    if(vm.count("discriminators")){
-        std::unordered_map<std::string, std::vector<std::string>> asm_addresses;
+void fill_discriminator_cache(const function_views& views, gooda::afdo_data& data, const gooda::converter_config& config, gooda::converter_context& context, gooda::symbol_cache* cache){
+    if(config.discriminators){
+        auto& symbols = context.symbols();
+        auto& statistics = context.statistics();
 
-        for(auto& function : data.functions){
-            auto& file = report.asm_file(function.i);
+        address_values values;
 
-            for(std::size_t j = 0; j < file.lines(); ++j){
-                auto& line = file.line(j);
+        for(auto& function : data.functions){
+            auto shared = get_executable_symbols(context, function.executable_file, config.discriminators);
+            auto& executable_values = values[function.executable_file];
 
-                auto address = line.get_string(file.column(ADDRESS));
-                if(!address.empty() && line.get_string(file.column(INIT_FILE)).empty()){
-                    asm_addresses[function.executable_file].push_back(std::move(address));
+            for(auto address : views.at(function.i).discriminator_addresses){
+                if(shared.shared && shared.shared->discriminator_cache.find({shared.shared_id, address})){
+                    ++statistics.shared_addresses;
+                } else {
+                    executable_values.push_back(address);
                 }
             }
         }
 
-        for(auto& address_set : asm_addresses){
-            auto file = address_set.first;
-
-            if(!vm["folder"].as<std::string>().empty()){
-                file = vm["folder"].as<std::string>() + "/" + file;
-            }
+        address_sets asm_addresses;
+        auto shards = make_shards(values, asm_addresses, gooda::thread_count(config.jobs));
 
-            if(!gooda::exists(file)){
-                log::emit<log::Warning>() << "File " << file << " does not exist" << log::endl;
+        for(auto& shard : shards){
+            statistics.symbolized_addresses += shard.last - shard.first;
+        }
 
-                continue;
-            }
+        std::vector<std::vector<std::pair<std::string, gooda::afdo_pos>>> results(shards.size());
 
-            log::emit<log::Debug>() << "Discriminator Query " << file << " with " << vm["addr2line"].as<std::string>() << log::endl;
+        query_addr2line(shards, config, context.pool(), cache, "Discriminator Query", [&results](std::size_t i, const std::string& address, std::vector<gooda::addr2line_frame>& frames){
+            //The outermost location is the one of the instruction
+            if(!frames.empty()){
+                std::string file_name;
+                std::string line_number;
+                gcov_unsigned_t discriminator;
 
-            std::ofstream address_file;
-            address_file.open("addresses", std::ios::out );
+                parse_location(frames.back().location, file_name, line_number, discriminator);
 
-            for(auto& address : address_set.second){
-                address_file << address << " ";
+                if(line_number != "?"){
+                    results[i].emplace_back(address, gooda::afdo_pos("", file_name, boost::lexical_cast<gcov_unsigned_t>(line_number), discriminator));
+                } else {
+                    results[i].emplace_back(address, gooda::afdo_pos("", "", 0, 0));
+                }
             }
+        });
 
-            address_file << std::endl;
-
-            auto command = vm["addr2line"].as<std::string>() + " -i -a --exe=" + file + " @addresses";
-            log::emit<log::Trace>() << "Run command \"" << command << "\"" << log::endl;
-            auto result = gooda::exec_command_result(command);
-
-            remove("addresses");
-
-            std::istringstream result_stream(result);
-            std::string str_line;
+        //Fill the discriminator cache, in the order of the shards
 
-            std::string address;
-
-            while (std::getline(result_stream, str_line)) {
-                if(boost::starts_with(str_line, "0x000000")){
-                    address = extract_address(str_line);
-                } else {
-                    auto key = std::make_pair(address_set.first, address);
-
-                    std::string file_name;
-                    std::string line_number;
-                    gcov_unsigned_t discriminator;
-
-                    auto start_disc = str_line.find("(discriminator ");
-                    auto start_number = str_line.rfind(":");
-
-                    if(start_disc == std::string::npos){
-                        line_number = str_line.substr(start_number + 1, str_line.size() - start_number - 1);
-                        file_name = str_line.substr(0, start_number);
-                        discriminator = 0;
-                    } else {
-                        line_number = str_line.substr(start_number + 1, start_disc - start_number - 2);
-                        file_name = str_line.substr(0, start_number);
-
-                        auto end = str_line.find(")", start_disc);
-                        auto discriminator_str = str_line.substr(start_disc + 15, end - start_disc - 15);
-                        discriminator = boost::lexical_cast<gcov_unsigned_t>(discriminator_str);
-                    }
-
-                    if(line_number != "?"){
-                        discriminator_cache[key] = {"", file_name, boost::lexical_cast<gcov_unsigned_t>(line_number), discriminator};
-                    } else {
-                        discriminator_cache[key] = {"", "", 0, 0};
-                    }
-                }
+        for(std::size_t i = 0; i < shards.size(); ++i){
+            for(auto& result : results[i]){
+                symbols.discriminator_cache[{symbols.executable_id(shards[i].executable->first), parse_address(result.first)}] = std::move(result.second);
             }
         }
     }
 }
 
+/*!
+ * \brief Read the mangled names of the symbols of the text section of an executable with objdump.
+ * \param file The path to the executable
+ * \param names The vector receiving the address and the name of each symbol
+ */
+void read_mangled_names(const std::string& file, std::vector<std::pair<std::string, std::string>>& names){
+    //The symbols are parsed while objdump is still writing them
+    gooda::run_command({"objdump", "--section=.text", "--syms", file}, "", [&names](std::string& str_line){
+        if(boost::starts_with(str_line, "000000")){
+            auto address = "0x" + str_line.substr(10, 6);
+
+            std::string sep("              ");
+            auto search = str_line.find(sep);
+
+            if(search != std::string::npos){
+                auto function_name = str_line.substr(search + sep.size(), str_line.size() - search - sep.size());
+                names.emplace_back(std::move(address), std::move(function_name));
+            }
+        }
+    });
+}
+
 /*!
  * \brief Update the function names to use the mangled names.
- * \param report The gooda report to fill
+ * \param views The typed views of the functions
  * \param data The data already filled
- * \param vm The configuration
+ * \param config The configuration
+ * \param cache The symbol cache, nullptr if disabled
  */
-void update_function_names(const gooda::gooda_report& report, gooda::afdo_data& data, boost::program_options::variables_map& vm){
-    std::unordered_map<std::string, std::vector<std::string>> asm_addresses;
+void update_function_names(const function_views& views, gooda::afdo_data& data, const gooda::converter_config& config, gooda::symbol_cache* cache){
+    address_sets asm_addresses;
     std::unordered_map<std::pair<std::string, std::string>, std::string> mangled_names;
     std::unordered_map<std::size_t, std::pair<std::string, std::string>> function_addresses;
 
@@ -726,65 +1326,69 @@ void update_function_names(const gooda::gooda_report& report, gooda::afdo_data&
     std::size_t cpp_files = 0;
 
     for(auto& function : data.functions){
-        auto& file = report.asm_file(function.i);
-
-        //Get the first non empty address and put it on the map
-        for(std::size_t j = 0; j < file.lines(); ++j){
-            auto& line = file.line(j);
+        auto& view = views.at(function.i);
 
-            auto address = line.get_string(file.column(ADDRESS));
-            if(!address.empty() && !boost::starts_with(line.get_string(file.column(DISASSEMBLY)), "Basic Block")){
-                function_addresses[function.i] = {function.executable_file, address};
-                asm_addresses[function.executable_file].push_back(std::move(address));
-
-                auto princ_file = line.get_string(file.column(PRINC_FILE));
-                if(boost::ends_with(princ_file, ".cpp")){
-                    ++cpp_files;
-                }
+        //The first non empty address has been found by the sweep
+        if(!view.first_address.empty()){
+            function_addresses[function.i] = {function.executable_file, view.first_address};
+            asm_addresses[function.executable_file].push_back(view.first_address);
 
-                break;
+            if(view.cpp){
+                ++cpp_files;
             }
         }
     }
 
     bool cpp = cpp_files > data.functions.size() * 0.5;
 
-    //Collect the mangled function names
+    //Collect the mangled function names, one executable per task
 
-    for(auto& address_set : asm_addresses){
-        auto file = address_set.first;
+    std::vector<address_sets::const_iterator> executables;
+    for(auto it = asm_addresses.cbegin(); it != asm_addresses.cend(); ++it){
+        executables.push_back(it);
+    }
 
-        if(!vm["folder"].as<std::string>().empty()){
-            file = vm["folder"].as<std::string>() + "/" + file;
-        }
+    std::vector<std::vector<std::pair<std::string, std::string>>> results(executables.size());
+
+    auto folder = config.folder;
+
+    gooda::parallel_for_each(executables.size(), gooda::thread_count(config.jobs), [&](std::size_t i){
+        auto file = gooda::executable_path(executables[i]->first, folder);
 
         if(!gooda::exists(file)){
             log::emit<log::Warning>() << "File " << file << " does not exist" << log::endl;
 
-            continue;
+            return;
         }
 
-        log::emit<log::Debug>() << "Mangled Query " << file << " with objdump" << log::endl;
+        auto id = cache ? cache->build_id(file) : std::string();
 
-        auto command = "objdump --section=.text --syms " + file;
-        auto result = gooda::exec_command_result(command);
-        log::emit<log::Trace>() << "Run command \"" << command << "\"" << log::endl;
+        if(!id.empty() && cache->lookup_names(id, executables[i]->second, results[i])){
+            log::emit<log::Debug>() << "Mangled Query " << file << " from the symbol cache" << log::endl;
+
+            return;
+        }
 
-        std::istringstream result_stream(result);
-        std::string str_line;
+        log::emit<log::Debug>() << "Mangled Query " << file << " with objdump" << log::endl;
 
-        while (std::getline(result_stream, str_line)) {
-            if(boost::starts_with(str_line, "000000")){
-                auto address = "0x" + str_line.substr(10, 6);
+        read_mangled_names(file, results[i]);
 
-                std::string sep("              ");
-                auto search = str_line.find(sep);
+        //Only the names of the queried addresses are cached, an empty name if there is no symbol
+        if(!id.empty()){
+            std::unordered_map<std::string, std::string> names(results[i].begin(), results[i].end());
 
-                if(search != std::string::npos){
-                    auto function_name = str_line.substr(search + sep.size(), str_line.size() - search - sep.size());
-                    mangled_names[{address_set.first, address}] = function_name;
-                }
+            std::vector<gooda::symbol_name> entries;
+            for(auto& address : executables[i]->second){
+                entries.emplace_back(address, names[address]);
             }
+
+            cache->store_names(id, entries);
+        }
+    });
+
+    for(std::size_t i = 0; i < executables.size(); ++i){
+        for(auto& result : results[i]){
+            mangled_names[{executables[i]->first, result.first}] = std::move(result.second);
         }
     }
 
@@ -817,13 +1421,7 @@ inline void cleanup(std::string& file_name, const std::string& pwd){
  * \param data The AFDO profile to clean.
  */
 void strip_paths(gooda::afdo_data& data){
-    auto command = "pwd";
-    auto pwd = gooda::exec_command_result(command);
-
-    //Remove the trailing end of line character
-    if(pwd[pwd.size() - 1] == '\n'){
-        pwd.erase(pwd.size() - 1, pwd.size());
-    }
+    auto pwd = gooda::current_directory();
 
     //Make sure that there will be no trailing slash in the resulting paths
     if(pwd[pwd.size() - 1] != '/'){
@@ -841,21 +1439,30 @@ void strip_paths(gooda::afdo_data& data){
     }
 }
 
+/*!
+ * \brief Add the strings of a function to the string table of the data
+ * \param function The function
+ * \param data The data whose string table is filled
+ */
+void add_file_names(const gooda::afdo_function& function, gooda::afdo_data& data){
+    data.add_file_name(function.name);
+    data.add_file_name(function.file);
+
+    for(auto& stack : function.stacks){
+        for(auto& pos : stack.stack){
+            data.add_file_name(pos.file);
+            data.add_file_name(pos.func);
+        }
+    }
+}
+
 /*!
  * \brief Fill the string table of the data
  * \param data The data already filled
  */
 void fill_file_name_table(gooda::afdo_data& data){
     for(auto& function : data.functions) {
-        data.add_file_name(function.name);
-        data.add_file_name(function.file);
-
-        for(auto& stack : function.stacks){
-            for(auto& pos : stack.stack){
-                data.add_file_name(pos.file);
-                data.add_file_name(pos.func);
-            }
-        }
+        add_file_names(function, data);
     }
 }
 
@@ -902,35 +1509,204 @@ std::size_t total_count(const gooda::gooda_report& report, const std::string& co
     return total;
 }
 
-} //End of anonymous namespace
+/*!
+ * \brief Return the order in which to process the given functions, the largest first, so that they do not end up alone at the end.
+ * \param count The number of functions
+ * \param size Functor returning the size of a function from its index
+ * \return The indices of the functions, in processing order
+ */
+template<typename Size>
+std::vector<std::size_t> largest_first(std::size_t count, Size size){
+    std::vector<std::size_t> order(count);
+    for(std::size_t i = 0; i < count; ++i){
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&size](std::size_t lhs, std::size_t rhs){
+        return size(lhs) > size(rhs);
+    });
+
+    return order;
+}
+
+/*!
+ * \brief Only keep the hottest functions, if --top or --coverage is set.
+ *
+ * The functions are ranked by decreasing total count. They are admitted until --top functions are
+ * admitted or until the admitted functions cover the --coverage fraction of the total count of all
+ * the functions, whichever comes first. The admitted functions keep their order.
+ *
+ * \param functions The functions to select from
+ * \param config The configuration
+ */
+void select_hottest_functions(std::vector<gooda::afdo_function>& functions, const gooda::converter_config& config){
+    if(config.top == 0 && config.coverage <= 0.0){
+        return;
+    }
+
+    std::size_t top = config.top > 0 ? config.top : functions.size();
+    double coverage = config.coverage > 0.0 ? config.coverage : 1.0;
+
+    double total = 0.0;
+    for(auto& function : functions){
+        total += function.total_count;
+    }
+
+    auto order = largest_first(functions.size(), [&functions](std::size_t i){
+        return functions[i].total_count;
+    });
+
+    std::vector<bool> admitted(functions.size(), false);
+
+    std::size_t count = 0;
+    double covered = 0.0;
+
+    while(count < order.size() && count < top && (count == 0 || covered < coverage * total)){
+        admitted[order[count]] = true;
+        covered += functions[order[count]].total_count;
+        ++count;
+    }
+
+    log::emit<log::Debug>() << "Admit " << count << " of " << functions.size() << " functions, covering "
+        << (total > 0.0 ? 100.0 * covered / total : 100.0) << "% of the count" << log::endl;
+
+    std::size_t next = 0;
+    for(std::size_t i = 0; i < functions.size(); ++i){
+        if(admitted[i]){
+            if(next != i){
+                functions[next] = std::move(functions[i]);
+            }
+
+            ++next;
+        }
+    }
+
+    functions.resize(next);
+}
+
+/*!
+ * \brief Sweep the assembly view of each candidate function, concurrently.
+ * \param report The Gooda report
+ * \param candidates The candidate functions
+ * \param ws Indicate if the working set will be computed
+ * \param jobs The number of threads
+ * \tparam Policy The counter policy
+ * \return The typed views, in the order of the candidates
+ */
+template<typename Policy>
+std::vector<function_view> sweep_functions(const gooda::gooda_report& report, const std::vector<gooda::afdo_function>& candidates, bool ws, std::size_t jobs){
+    auto order = largest_first(candidates.size(), [&report, &candidates](std::size_t i){
+        return report.asm_file(candidates[i].i).lines();
+    });
+
+    std::vector<function_view> views(candidates.size());
+
+    gooda::parallel_for_each(order.size(), jobs, [&](std::size_t t){
+        views[order[t]] = sweep_function<Policy>(report, candidates[order[t]].i, ws);
+    });
+
+    return views;
+}
+
+/*!
+ * \brief Generate the inline stacks of the functions, one task per function.
+ *
+ * Each task only writes its own function and its own view, the symbolization results are only read.
+ * The weighted counts of the instructions are collected at the same time for the working set.
+ *
+ * \param data The AFDO profile
+ * \param views The typed views of the functions
+ * \param context The context of the conversion
+ * \param config The configuration
+ * \param jobs The number of threads
+ * \tparam Policy The counter policy
+ */
+template<typename Policy>
+void annotate_functions(gooda::afdo_data& data, function_views& views, gooda::converter_context& context, const gooda::converter_config& config, std::size_t jobs){
+    auto order = largest_first(data.functions.size(), [&views, &data](std::size_t i){
+        return views.at(data.functions[i].i).rows.size();
+    });
+
+    std::vector<gooda::converter_statistics> function_statistics(data.functions.size());
 
-void gooda::convert_to_afdo(const gooda::gooda_report& report, gooda::afdo_data& data, boost::program_options::variables_map& vm){
+    gooda::parallel_for_each(order.size(), jobs, [&](std::size_t t){
+        auto& function = data.functions[order[t]];
+        auto& view = views.at(function.i);
+
+        auto symbols = get_executable_symbols(context, function.executable_file, config.discriminators);
+
+        annotate<Policy>(function, view, symbols, function_statistics[order[t]]);
+
+        if(config.working_set){
+            for(auto& row : view.rows){
+                if(row.has_address && !row.basic_block){
+                    check_parsed(row.valid_weight, function.name, "counter");
+
+                    view.counts.push_back(view.multiplex_weight * row.weight);
+                }
+            }
+        }
+    });
+
+    for(auto& statistics : function_statistics){
+        context.statistics().instructions += statistics.instructions;
+        context.statistics().missing_stacks += statistics.missing_stacks;
+    }
+}
+
+/*!
+ * \brief Select the conversion mode and verify that the report is valid for it.
+ * \param report The Gooda report
+ * \param config The configuration
+ * \return true if the LBR mode is selected, false for cycle accounting
+ */
+bool select_mode(const gooda::gooda_report& report, const gooda::converter_config& config){
     bool lbr;
-    if(vm.count("auto")){
+    if(config.auto_mode){
         auto total_count_lbr = total_count(report, BB_EXEC);
         lbr = total_count_lbr > 0;
     } else {
-        lbr = vm.count("lbr");
+        lbr = config.lbr;
     }
 
     //Choose the correct counter
     std::string counter_name = lbr ? BB_EXEC : UNHALTED_CORE_CYCLES;
 
     //Verify that the file has the correct column
-    if(!vm.count("auto") && total_count(report, counter_name) == 0){
+    if(!config.auto_mode && total_count(report, counter_name) == 0){
         throw gooda::gooda_exception("The file is not valid for the current mode");
     }
 
-    //Empty each cache
-    inlining_cache.clear();
-    discriminator_cache.clear();
+    return lbr;
+}
 
-    auto filter = get_process_filter(report, vm, counter_name);
-    log::emit<log::Debug>() << "Filter by \"" << filter << "\"" << log::endl;
+/*!
+ * \brief Collect the hotspot functions of the given process that have an assembly view.
+ *
+ * The functions without assembly view cannot be converted, they are removed before the
+ * selection of the hottest functions so that they do not take the place of other functions.
+ *
+ * \param report The Gooda report
+ * \param lbr Indicate if lbr is activated or not
+ * \param filter The process to keep, empty to keep all the processes
+ * \param has_asm_view Functor indicating if the function of the given index has an assembly view
+ * \tparam Functor The type of the functor
+ * \return The candidate functions, in the order of the report
+ */
+template<typename Functor>
+std::vector<gooda::afdo_function> collect_candidates(const gooda::gooda_report& report, bool lbr, const std::string& filter, Functor has_asm_view){
+    std::string counter_name = lbr ? BB_EXEC : UNHALTED_CORE_CYCLES;
+
+    std::vector<gooda::afdo_function> candidates;
 
     for(std::size_t i = 0; i < report.functions(); ++i){
         auto& line = report.hotspot_function(i);
 
+        //We need the asm file to continue
+        if(!has_asm_view(i)){
+            continue;
+        }
+
         //Only if the function passes the filters
         if(filter.empty() || line.get_string(report.get_hotspot_file().column(PROCESS)) == filter){
             auto string_cycles = line.get_string(report.get_hotspot_file().column(counter_name));
@@ -956,84 +1732,152 @@ void gooda::convert_to_afdo(const gooda::gooda_report& report, gooda::afdo_data&
                 function.total_count = static_cast<gcov_type>(count);
             }
 
-            //We need the asm file to continue
+            candidates.push_back(std::move(function));
+        }
+    }
 
-            if(!report.has_asm_file(function.i)){
-                continue;
-            }
+    return candidates;
+}
 
-            //Check that the function file is correctly set
+/*!
+ * \brief Collect the hotspot functions of the given process that have an assembly view in the report.
+ * \param report The Gooda report
+ * \param lbr Indicate if lbr is activated or not
+ * \param filter The process to keep, empty to keep all the processes
+ * \return The candidate functions, in the order of the report
+ */
+std::vector<gooda::afdo_function> collect_candidates(const gooda::gooda_report& report, bool lbr, const std::string& filter){
+    return collect_candidates(report, lbr, filter, [&report](std::size_t i){ return report.has_asm_file(i); });
+}
 
-            auto& file = report.asm_file(function.i);
+/*!
+ * \brief Sweep the candidate functions and add the valid ones to the AFDO profile.
+ *
+ * The views are indexed by the offset plus the position of the function in the report, which
+ * becomes the index of the function, so that the functions of several reports can be converted
+ * together.
+ *
+ * \param report The Gooda report
+ * \param candidates The candidate functions
+ * \param data The AFDO profile receiving the valid functions
+ * \param views The typed views receiving the views of the valid functions
+ * \param config The configuration
+ * \param lbr Indicate if lbr is activated or not
+ * \param offset The offset of the indices of the functions of the report
+ */
+void prepare_functions(const gooda::gooda_report& report, std::vector<gooda::afdo_function>& candidates, gooda::afdo_data& data, function_views& views, const gooda::converter_config& config, bool lbr, std::size_t offset){
+    //Sweep the assembly view of each function once, the largest views first, so that they do not end up alone at the end
+    //Everything the conversion needs from the view is extracted by the sweep
 
-            bool invalid = false;
+    auto jobs = gooda::thread_count(config.jobs);
+    bool ws = config.working_set;
 
-            for(std::size_t j = 0; j < file.lines(); ++j){
-                auto& line = file.line(j);
+    auto candidate_views = lbr
+        ? sweep_functions<lbr_policy>(report, candidates, ws, jobs)
+        : sweep_functions<cycles_policy>(report, candidates, ws, jobs);
 
-                //Basic Block have no file
-                if(boost::starts_with(line.get_string(file.column(DISASSEMBLY)), "Basic Block")){
-                    continue;
-                }
+    for(std::size_t i = 0; i < candidates.size(); ++i){
+        auto& function = candidates[i];
+        auto& view = candidate_views[i];
 
-                //Line without addresses have special meaning
-                if(line.get_string(file.column(ADDRESS)).empty()){
-                    continue;
-                }
+        //Gooda does not always found the source file of a function
+        if(!view.invalid.empty()){
+            log::emit<log::Warning>() << function.name << " is invalid (" << view.invalid << ")" << log::endl;
 
-                //Gooda does not always found the source file of a function
-                //In that case, declare the function as invalid and return quickly
-                auto princ_file = line.get_string(file.column(PRINC_FILE));
-                if(princ_file == "null"){
-                    log::emit<log::Warning>() << function.name << " is invalid (null file)" << log::endl;
+            continue;
+        }
 
-                    invalid = true;
-                    break;
-                }
+        function.file = view.file;
+        function.entry_count = view.entry_count;
 
-                if(princ_file.empty()){
-                    log::emit<log::Warning>() << function.name << " is invalid (empty file)" << log::endl;
+        gooda_assert(!function.file.empty(), "The function file must be set");
 
-                    invalid = true;
-                    break;
-                }
-            }
+        function.i += offset;
+        views[function.i] = std::move(view);
 
-            if(invalid){
-                continue;
-            }
+        //Add the function
 
-            //Add the function
+        data.functions.push_back(std::move(function));
+    }
+}
 
-            data.functions.push_back(std::move(function));
-        }
+/*!
+ * \brief Return the symbol cache of a conversion, the one of the context if it has one.
+ * \param config The configuration
+ * \param context The context of the conversion
+ * \return The symbol cache, nullptr if the symbols are not cached
+ */
+std::shared_ptr<gooda::symbol_cache> open_symbol_cache(const gooda::converter_config& config, gooda::converter_context& context){
+    if(context.get_symbol_cache()){
+        return context.get_symbol_cache();
+    } else if(!config.symcache.empty()){
+        return std::make_shared<gooda::symbol_cache>(config.symcache);
     }
 
+    return nullptr;
+}
+
+/*!
+ * \brief Symbolize the functions of the AFDO profile and generate their inline stacks.
+ * \param data The AFDO profile
+ * \param views The typed views of the functions
+ * \param config The configuration
+ * \param context The context of the conversion
+ * \param lbr Indicate if lbr is activated or not
+ */
+void annotate_profile(gooda::afdo_data& data, function_views& views, const gooda::converter_config& config, gooda::converter_context& context, bool lbr){
+    auto cache = open_symbol_cache(config, context);
+
+    auto jobs = gooda::thread_count(config.jobs);
+
     //Update function names (replace unmangled with mangled names)
-    update_function_names(report, data, vm);
+    update_function_names(views, data, config, cache.get());
 
     //Fill the inlining cache (gets inlined function names)
-    fill_inlining_cache(report, data, vm);
+    fill_inlining_cache(views, data, config, context, cache.get());
 
     //Fill the discriminator cache (gets the discriminators of each lines)
-    fill_discriminator_cache(report, data, vm);
+    fill_discriminator_cache(views, data, config, context, cache.get());
 
     //Generate the inline stacks
+    if(lbr){
+        annotate_functions<lbr_policy>(data, views, context, config, jobs);
+    } else {
+        annotate_functions<cycles_policy>(data, views, context, config, jobs);
+    }
+}
 
-    for(auto& function : data.functions){
-        //Collect function.file and function.entry_count
-        auto bbs = collect_basic_blocks(report, function, lbr);
+/*!
+ * \brief Convert the candidate functions into the AFDO profile.
+ *
+ * The assembly view of each function is swept once, then the valid functions are added to the
+ * profile, their addresses are symbolized and their inline stacks are generated.
+ *
+ * \param report The Gooda report
+ * \param candidates The candidate functions
+ * \param data The AFDO profile receiving the valid functions
+ * \param config The configuration
+ * \param context The context of the conversion
+ * \param lbr Indicate if lbr is activated or not
+ * \return The typed views of the valid functions
+ */
+function_views convert_functions(const gooda::gooda_report& report, std::vector<gooda::afdo_function>& candidates, gooda::afdo_data& data, const gooda::converter_config& config, gooda::converter_context& context, bool lbr){
+    function_views views;
 
-        if(lbr){
-            lbr_annotate(report, function, bbs);
-        } else {
-            ca_annotate(report, function, bbs);
-        }
-    }
+    prepare_functions(report, candidates, data, views, config, lbr, 0);
+    annotate_profile(data, views, config, context, lbr);
 
-    //Prune uncounted functions
-    prune_uncounted_functions(data);
+    return views;
+}
 
+/*!
+ * \brief Complete an AFDO profile whose functions are annotated: file name table, working set and section lengths.
+ * \param counts The count of each instruction of the profile
+ * \param total_count The sum of the counts
+ * \param data The AFDO profile
+ * \param jobs The number of threads
+ */
+void complete_profile(std::vector<uint64_t>& counts, uint64_t total_count, gooda::afdo_data& data, std::size_t jobs){
     //Strip current directory from paths
     strip_paths(data);
 
@@ -1041,11 +1885,801 @@ void gooda::convert_to_afdo(const gooda::gooda_report& report, gooda::afdo_data&
     fill_file_name_table(data);
 
     //Compute the working set
-    compute_working_set(report, data, vm, lbr);
+    gooda::compute_working_set(counts, total_count, data, jobs);
 
     //Set the sizes of the different sections
     compute_lengths(data);
+}
+
+/*!
+ * \brief Complete an AFDO profile whose functions are annotated: file name table, working set and section lengths.
+ * \param histogram The number of instructions of each count of the profile
+ * \param total_count The sum of the counts
+ * \param data The AFDO profile
+ */
+void complete_profile(std::vector<std::pair<uint64_t, uint64_t>>& histogram, uint64_t total_count, gooda::afdo_data& data){
+    //Strip current directory from paths
+    strip_paths(data);
+
+    //Fill the file name table with the strings from the AFDO profile
+    fill_file_name_table(data);
+
+    //Compute the working set
+    gooda::compute_working_set(histogram, total_count, data);
+
+    //Set the sizes of the different sections
+    compute_lengths(data);
+}
+
+/*!
+ * \brief Complete an AFDO profile whose functions are annotated: file name table, working set and section lengths.
+ * \param views The typed views of the functions
+ * \param data The AFDO profile
+ * \param jobs The number of threads
+ */
+void complete_profile(const function_views& views, gooda::afdo_data& data, std::size_t jobs){
+    std::vector<uint64_t> counts;
+    uint64_t total_count = 0;
+
+    collect_working_set(views, data, counts, total_count);
+
+    complete_profile(counts, total_count, data, jobs);
+}
+
+/*!
+ * \brief Scale the counts of a function and of its stacks.
+ * \param function The AFDO function
+ * \param weight The scaling factor
+ */
+void scale_counts(gooda::afdo_function& function, double weight){
+    function.total_count = static_cast<gcov_type>(function.total_count * weight);
+    function.entry_count = static_cast<gcov_type>(function.entry_count * weight);
+
+    for(auto& stack : function.stacks){
+        stack.count = static_cast<gcov_type>(stack.count * weight);
+    }
+}
+
+/*!
+ * \brief Scale the counts of a function by the weight of its report.
+ * \param function The AFDO function
+ * \param view The typed view of the function
+ * \param weight The weight of the report
+ */
+void scale_function(gooda::afdo_function& function, function_view& view, double weight){
+    scale_counts(function, weight);
+
+    for(auto& count : view.counts){
+        count *= weight;
+    }
+}
+
+/*!
+ * \brief Merge the functions with the same key, coming from different profiles.
+ *
+ * The counts of the identical stacks are summed, the number of instructions and the cache misses
+ * of a stack are the maximum of the merged stacks. The functions keep the order of their first
+ * occurrence.
+ *
+ * \param data The AFDO profile
+ * \param key Functor returning the merge key of a function
+ * \tparam Key The type of the key functor
+ */
+template<typename Key>
+void merge_functions(gooda::afdo_data& data, Key key){
+    std::vector<gooda::afdo_function> merged;
+    std::vector<std::unique_ptr<stack_index>> indices;
+    std::unordered_map<std::string, std::size_t> positions;
+
+    for(auto& function : data.functions){
+        auto function_key = key(function);
+        auto it = positions.find(function_key);
+
+        if(it == positions.end()){
+            positions[function_key] = merged.size();
+            merged.push_back(std::move(function));
+            indices.emplace_back();
+
+            continue;
+        }
+
+        auto& target = merged[it->second];
+        auto& index = indices[it->second];
+
+        //The stacks of the target are indexed on the first merge
+        if(!index){
+            index.reset(new stack_index);
+
+            for(std::size_t i = 0; i < target.stacks.size(); ++i){
+                index->insert({hash_stack(target.stacks[i].stack), i});
+            }
+        }
+
+        target.total_count += function.total_count;
+        target.entry_count += function.entry_count;
+
+        for(auto& stack : function.stacks){
+            auto hash = hash_stack(stack.stack);
+            auto* existing = find_stack(target, *index, stack.stack, hash);
+
+            if(existing){
+                existing->count += stack.count;
+                existing->num_inst = std::max(existing->num_inst, stack.num_inst);
+                existing->cache_misses = std::max(existing->cache_misses, stack.cache_misses);
+            } else {
+                auto& added = add_stack(target, *index, stack.stack, hash);
+                added.count = stack.count;
+                added.num_inst = stack.num_inst;
+                added.cache_misses = stack.cache_misses;
+            }
+        }
+    }
+
+    data.functions = std::move(merged);
+}
+
+/*!
+ * \brief Compute the merge keys of the functions of one profile.
+ *
+ * The functions of a single profile are never merged together (several processes can run the same
+ * executable), the nth occurrence of a function in a profile is merged with the nth occurrence in the
+ * others.
+ *
+ * \param data The AFDO profile holding the functions of all the profiles
+ * \param first The position of the first function of the profile
+ * \param last The position after the last function of the profile
+ * \param executables Indicates if the functions are identified by executable and by name, or only by name
+ * \param keys The merge keys, indexed by the position of the functions in the spreadsheets
+ */
+void occurrence_keys(const gooda::afdo_data& data, std::size_t first, std::size_t last, bool executables, std::unordered_map<std::size_t, std::string>& keys){
+    std::unordered_map<std::string, std::size_t> occurrences;
+
+    for(auto i = first; i < last; ++i){
+        auto& function = data.functions[i];
+        auto base = executables ? function.executable_file + '\0' + function.name : function.name;
+
+        keys[function.i] = base + '\0' + std::to_string(occurrences[base]++);
+    }
+}
+
+/*!
+ * \brief Log the statistics of the last conversion of the context.
+ * \param context The context of the conversion
+ */
+void log_statistics(const gooda::converter_context& context){
+    auto& statistics = context.statistics();
+    log::emit<log::Debug>() << "Converted " << statistics.functions << " functions, " << statistics.instructions << " instructions ("
+        << statistics.missing_stacks << " without inline stack), " << statistics.symbolized_addresses << " symbolized addresses ("
+        << statistics.shared_addresses << " shared)" << log::endl;
+}
+
+/*!
+ * \brief Populate one AFDO profile for each partition of the hotspot functions.
+ *
+ * The report is swept once and the functions of all the partitions are symbolized and annotated
+ * together, then routed to the profile of their partition. The hottest functions are selected
+ * in each partition and the profiles are completed concurrently.
+ *
+ * \param report The Gooda report
+ * \param profiles The AFDO profile of each partition, indexed by partition name.
+ * \param config The configuration
+ * \param context The context of the conversion
+ * \param filter Indicates if the process filter applies
+ * \param partition Functor returning the partition of a function
+ * \tparam Partition The type of the partition functor
+ */
+template<typename Partition>
+void convert_partitions(const gooda::gooda_report& report, std::map<std::string, gooda::afdo_data>& profiles, const gooda::converter_config& config, gooda::converter_context& context, bool filter, Partition partition){
+    auto lbr = select_mode(report, config);
+
+    //Empty the results of the previous conversion
+    context.reset();
+
+    std::string process;
+    if(filter){
+        std::string counter_name = lbr ? BB_EXEC : UNHALTED_CORE_CYCLES;
+
+        process = get_process_filter(report, config, counter_name);
+        log::emit<log::Debug>() << "Filter by \"" << process << "\"" << log::endl;
+    }
+
+    //Partition the hotspot functions, the hottest functions are selected in each partition
+
+    std::map<std::string, std::vector<gooda::afdo_function>> partitions;
+
+    for(auto& function : collect_candidates(report, lbr, process)){
+        partitions[partition(function)].push_back(std::move(function));
+    }
+
+    std::vector<gooda::afdo_function> candidates;
+
+    for(auto& functions : partitions){
+        select_hottest_functions(functions.second, config);
+
+        std::move(functions.second.begin(), functions.second.end(), std::back_inserter(candidates));
+    }
+
+    log::emit<log::Debug>() << "Split " << candidates.size() << " functions into " << partitions.size() << " partitions" << log::endl;
+
+    //The functions of all the partitions are symbolized and annotated together
+
+    gooda::afdo_data data;
+    auto views = convert_functions(report, candidates, data, config, context, lbr);
+
+    //Prune uncounted functions
+    prune_uncounted_functions(data);
+
+    context.statistics().functions = data.functions.size();
+
+    for(auto& function : data.functions){
+        auto name = partition(function);
+        profiles[name].functions.push_back(std::move(function));
+    }
+
+    //Complete the profiles concurrently, each with its own string table and working set
+
+    std::vector<gooda::afdo_data*> partition_profiles;
+    for(auto& profile : profiles){
+        partition_profiles.push_back(&profile.second);
+    }
+
+    gooda::parallel_for_each(partition_profiles.size(), gooda::thread_count(config.jobs), [&](std::size_t i){
+        complete_profile(views, *partition_profiles[i], 1);
+    });
+
+    log_statistics(context);
+}
+
+/*!
+ * \typedef symbol_tables
+ * \brief The mangled name of each symbol address, for each executable.
+ */
+typedef std::unordered_map<std::string, std::unordered_map<std::string, std::string>> symbol_tables;
+
+/*!
+ * \brief Give a streamed function its mangled name.
+ *
+ * The symbols of each executable are read once with objdump and kept for the following functions.
+ *
+ * \param function The AFDO function
+ * \param view The typed view of the function
+ * \param config The configuration
+ * \param tables The symbol tables of the executables already read
+ */
+void stream_function_name(gooda::afdo_function& function, const function_view& view, const gooda::converter_config& config, symbol_tables& tables){
+    auto it = tables.find(function.executable_file);
+
+    if(it == tables.end()){
+        it = tables.emplace(function.executable_file, std::unordered_map<std::string, std::string>()).first;
+
+        auto file = gooda::executable_path(function.executable_file, config.folder);
+
+        if(gooda::exists(file)){
+            log::emit<log::Debug>() << "Mangled Query " << file << " with objdump" << log::endl;
+
+            std::vector<std::pair<std::string, std::string>> names;
+            read_mangled_names(file, names);
+
+            //The last symbol of an address wins, like for the batch conversion
+            for(auto& name : names){
+                it->second[name.first] = std::move(name.second);
+            }
+        } else {
+            log::emit<log::Warning>() << "File " << file << " does not exist" << log::endl;
+        }
+    }
+
+    auto name = it->second.find(view.first_address);
+    function.name = name == it->second.end() ? std::string() : name->second;
+
+    //In C++ mode the name always should always start with underscore
+    if(function.name.empty() || (view.cpp && function.name[0] != '_')){
+        log::emit<log::Warning>() << "addr2line reported invalid name for a function: " << function.name << log::endl;
+    }
+}
+
+/*!
+ * \brief Convert the candidate functions one at a time and spool them.
+ *
+ * The assembly view of each function is read, converted and released before the next one, the
+ * symbolization results of a function are released once it is spooled. Only the string table and
+ * the histogram of the counts grow with the profile.
+ *
+ * \param directory The spreadsheets directory
+ * \param report The Gooda report, without assembly views
+ * \param candidates The candidate functions
+ * \param table The AFDO profile receiving the string table
+ * \param spool The spool receiving the functions
+ * \param config The configuration
+ * \param context The context of the conversion
+ * \param histogram The number of instructions of each count
+ * \param total_count The sum of the counts
+ * \return The length of the spooled function records
+ * \tparam Policy The counter policy
+ */
+template<typename Policy>
+unsigned int stream_functions(const std::string& directory, gooda::gooda_report& report, std::vector<gooda::afdo_function>& candidates, gooda::afdo_data& table, gooda::afdo_spool& spool,
+        const gooda::converter_config& config, gooda::converter_context& context, gooda::flat_hash_map<uint64_t, uint64_t>& histogram, uint64_t& total_count){
+    auto cache = open_symbol_cache(config, context);
+
+    bool lbr = Policy::block_counts;
+
+    symbol_tables tables;
+    unsigned int length = 0;
+
+    for(auto& candidate : candidates){
+        auto i = candidate.i;
+
+        if(!gooda::read_asm_view(directory, i, report)){
+            continue;
+        }
+
+        gooda::afdo_data data;
+        function_views views;
+
+        std::vector<gooda::afdo_function> function(1, std::move(candidate));
+        prepare_functions(report, function, data, views, config, lbr, 0);
+
+        //The view holds everything the conversion needs
+        report.release_asm_file(i);
+
+        if(data.functions.empty()){
+            continue;
+        }
+
+        stream_function_name(data.functions.front(), views.at(i), config, tables);
+
+        fill_inlining_cache(views, data, config, context, cache.get());
+        fill_discriminator_cache(views, data, config, context, cache.get());
+
+        annotate_functions<Policy>(data, views, context, config, 1);
+
+        //The addresses of the other functions are distinct
+        context.symbols().inlining_cache.clear();
+        context.symbols().discriminator_cache.clear();
+
+        prune_uncounted_functions(data);
+
+        if(data.functions.empty()){
+            continue;
+        }
+
+        for(auto count : views.at(i).counts){
+            ++histogram[count];
+            total_count += count;
+        }
+
+        strip_paths(data);
+        add_file_names(data.functions.front(), table);
+
+        //The count of the functions is not part of the record
+        compute_lengths(data);
+        length += data.length_function_section - 1;
+
+        spool.write(table, data.functions.front());
+
+        ++context.statistics().functions;
+    }
+
+    return length;
+}
+
+/*!
+ * \brief Build the typed view of a function from its samples.
+ *
+ * The view has a single basic block holding the sampled instructions, between the basic block header
+ * and the end of the view. All the instructions are symbolized with their inline stack.
+ *
+ * \param function The samples of the function
+ * \return The typed view of the function
+ */
+function_view sample_view(const gooda::perf_function& function){
+    function_view view;
+    view.multiplex_weight = 1.0;
+    view.multiplex_latency = 1.0;
+
+    view.rows.resize(function.samples.size() + 2);
+    view.rows.front().basic_block = true;
+
+    for(std::size_t j = 0; j < function.samples.size(); ++j){
+        auto& sample = function.samples[j];
+        auto& row = view.rows[j + 1];
+
+        row.address = sample.first;
+        row.weight = sample.second;
+        row.has_address = true;
+        row.inlined = true;
+        row.valid_line = true;
+        row.valid_weight = true;
+        row.valid_latency = true;
+
+        view.inlined_addresses.push_back(sample.first);
+
+        //There is no basic block, the entry count is the count of the first instruction
+        if(sample.first == function.address){
+            view.entry_count = cycles_policy::entry_count(view, sample.second);
+        }
+    }
+
+    view.basic_blocks.push_back({0, 0, view.rows.size() - 1});
+
+    return view;
+}
+
+/*!
+ * \brief Set the file of each sampled function from the inline stacks of its instructions.
+ *
+ * The file of a function is the file of the outermost frame of its first symbolized instruction.
+ * The functions without any symbolized instruction have no debug information and are removed.
+ *
+ * \param data The AFDO profile
+ * \param views The typed views of the functions
+ * \param context The context of the conversion
+ */
+void set_sampled_files(gooda::afdo_data& data, const function_views& views, gooda::converter_context& context){
+    auto it = std::remove_if(data.functions.begin(), data.functions.end(), [&views, &context](gooda::afdo_function& function){
+        auto symbols = get_executable_symbols(context, function.executable_file, false);
+
+        for(auto address : views.at(function.i).inlined_addresses){
+            auto* entry = symbols.find_inlined(address);
+
+            if(entry && !entry->positions.empty()){
+                function.file = entry->positions.back().file;
+                return false;
+            }
+        }
+
+        log::emit<log::Warning>() << function.name << " has no debug information" << log::endl;
+
+        return true;
+    });
+
+    data.functions.erase(it, data.functions.end());
+}
+
+} //End of anonymous namespace
+
+void gooda::convert_to_afdo(const gooda::gooda_report& report, gooda::afdo_data& data, const gooda::converter_config& config){
+    gooda::converter_context context;
+
+    convert_to_afdo(report, data, config, context);
+}
+
+void gooda::convert_to_afdo(const gooda::gooda_report& report, gooda::afdo_data& data, const gooda::converter_config& config, converter_context& context){
+    auto lbr = select_mode(report, config);
+
+    //Empty the results of the previous conversion
+    context.reset();
+
+    std::string counter_name = lbr ? BB_EXEC : UNHALTED_CORE_CYCLES;
+
+    auto filter = get_process_filter(report, config, counter_name);
+    log::emit<log::Debug>() << "Filter by \"" << filter << "\"" << log::endl;
+
+    auto candidates = collect_candidates(report, lbr, filter);
+
+    //Only keep the hottest functions if asked to
+    select_hottest_functions(candidates, config);
+
+    auto views = convert_functions(report, candidates, data, config, context, lbr);
+
+    //Prune uncounted functions
+    prune_uncounted_functions(data);
+
+    context.statistics().functions = data.functions.size();
+
+    complete_profile(views, data, gooda::thread_count(config.jobs));
+
+    log_statistics(context);
 
     //Note: No need to fill the modules because it is not used by GCC
     //It will be automatically written empty by the AFDO generator
 }
+
+void gooda::convert_to_afdo_by_process(const gooda::gooda_report& report, std::map<std::string, afdo_data>& profiles, const gooda::converter_config& config){
+    gooda::converter_context context;
+
+    convert_to_afdo_by_process(report, profiles, config, context);
+}
+
+void gooda::convert_to_afdo_by_process(const gooda::gooda_report& report, std::map<std::string, afdo_data>& profiles, const gooda::converter_config& config, converter_context& context){
+    convert_partitions(report, profiles, config, context, false, [&report](const gooda::afdo_function& function){
+        return report.hotspot_function(function.i).get_string(report.get_hotspot_file().column(PROCESS));
+    });
+}
+
+void gooda::convert_to_afdo_by_module(const gooda::gooda_report& report, std::map<std::string, afdo_data>& profiles, const gooda::converter_config& config){
+    gooda::converter_context context;
+
+    convert_to_afdo_by_module(report, profiles, config, context);
+}
+
+void gooda::convert_to_afdo_by_module(const gooda::gooda_report& report, std::map<std::string, afdo_data>& profiles, const gooda::converter_config& config, converter_context& context){
+    convert_partitions(report, profiles, config, context, true, [](const gooda::afdo_function& function){
+        return function.executable_file;
+    });
+}
+
+void gooda::aggregate_to_afdo(const std::vector<gooda_report>& reports, const std::vector<double>& weights, afdo_data& data, const gooda::converter_config& config){
+    gooda::converter_context context;
+
+    aggregate_to_afdo(reports, weights, data, config, context);
+}
+
+void gooda::aggregate_to_afdo(const std::vector<gooda_report>& reports, const std::vector<double>& weights, afdo_data& data, const gooda::converter_config& config, converter_context& context){
+    if(reports.empty()){
+        throw gooda::gooda_exception("There are no reports to aggregate");
+    }
+
+    if(!weights.empty() && weights.size() != reports.size()){
+        throw gooda::gooda_exception("There must be one weight for each aggregated report");
+    }
+
+    auto lbr = select_mode(reports.front(), config);
+
+    for(auto& report : reports){
+        if(select_mode(report, config) != lbr){
+            throw gooda::gooda_exception("The aggregated reports must all be of the same type");
+        }
+    }
+
+    //Empty the results of the previous conversion
+    context.reset();
+
+    std::string counter_name = lbr ? BB_EXEC : UNHALTED_CORE_CYCLES;
+
+    //Sweep the functions of each report, their indices are offset to remain unique
+
+    function_views views;
+    std::vector<std::size_t> first_functions;
+    std::size_t offset = 0;
+
+    for(auto& report : reports){
+        auto filter = get_process_filter(report, config, counter_name);
+
+        auto candidates = collect_candidates(report, lbr, filter);
+
+        //Only keep the hottest functions if asked to
+        select_hottest_functions(candidates, config);
+
+        first_functions.push_back(data.functions.size());
+        prepare_functions(report, candidates, data, views, config, lbr, offset);
+
+        offset += report.functions();
+    }
+
+    first_functions.push_back(data.functions.size());
+
+    //The functions are merged by executable and by name
+    std::unordered_map<std::size_t, std::string> keys;
+
+    for(std::size_t r = 0; r < reports.size(); ++r){
+        occurrence_keys(data, first_functions[r], first_functions[r + 1], true, keys);
+    }
+
+    //The addresses of all the reports are symbolized together, once per executable
+    annotate_profile(data, views, config, context, lbr);
+
+    if(!weights.empty()){
+        for(std::size_t r = 0; r < reports.size(); ++r){
+            for(auto i = first_functions[r]; i < first_functions[r + 1]; ++i){
+                scale_function(data.functions[i], views.at(data.functions[i].i), weights[r]);
+            }
+        }
+    }
+
+    //Prune uncounted functions
+    prune_uncounted_functions(data);
+
+    std::vector<uint64_t> counts;
+    uint64_t total_count = 0;
+
+    collect_working_set(views, data, counts, total_count);
+
+    merge_functions(data, [&keys](const gooda::afdo_function& function){ return keys.at(function.i); });
+
+    context.statistics().functions = data.functions.size();
+
+    complete_profile(counts, total_count, data, gooda::thread_count(config.jobs));
+
+    log_statistics(context);
+}
+
+void gooda::stream_to_afdo(const std::string& directory, const std::string& file, const gooda::converter_config& config){
+    gooda::converter_context context;
+
+    stream_to_afdo(directory, file, config, context);
+}
+
+void gooda::stream_to_afdo(const std::string& directory, const std::string& file, const gooda::converter_config& config, converter_context& context){
+    //Only the process and hotspot views are kept in memory
+    auto report = gooda::read_spreadsheet_index(directory);
+
+    auto lbr = select_mode(report, config);
+
+    //Empty the results of the previous conversion
+    context.reset();
+
+    std::string counter_name = lbr ? BB_EXEC : UNHALTED_CORE_CYCLES;
+
+    auto filter = get_process_filter(report, config, counter_name);
+    log::emit<log::Debug>() << "Filter by \"" << filter << "\"" << log::endl;
+
+    //The assembly views are not read yet, the candidates are the functions with an assembly view file
+    auto candidates = collect_candidates(report, lbr, filter, [&directory](std::size_t i){ return gooda::has_asm_view(directory, i); });
+
+    //Only keep the hottest functions if asked to
+    select_hottest_functions(candidates, config);
+
+    gooda::afdo_data table;
+    gooda::afdo_spool spool(file, config);
+
+    gooda::flat_hash_map<uint64_t, uint64_t> histogram;
+    uint64_t total_count = 0;
+
+    auto length = lbr
+        ? stream_functions<lbr_policy>(directory, report, candidates, table, spool, config, context, histogram, total_count)
+        : stream_functions<cycles_policy>(directory, report, candidates, table, spool, config, context, histogram, total_count);
+
+    std::vector<std::pair<uint64_t, uint64_t>> runs;
+    histogram.for_each([&runs](uint64_t count, uint64_t num_inst){
+        runs.emplace_back(count, num_inst);
+    });
+
+    gooda::compute_working_set(runs, total_count, table);
+
+    compute_lengths(table);
+    table.length_function_section += length;
+
+    log_statistics(context);
+
+    gooda::generate_afdo(table, spool, file, config);
+}
+
+void gooda::update_to_afdo(const gooda_report& report, afdo_data& history, double decay, afdo_data& data, const gooda::converter_config& config){
+    gooda::converter_context context;
+
+    update_to_afdo(report, history, decay, data, config, context);
+}
+
+void gooda::update_to_afdo(const gooda_report& report, afdo_data& history, double decay, afdo_data& data, const gooda::converter_config& config, converter_context& context){
+    auto lbr = select_mode(report, config);
+
+    //Empty the results of the previous conversion
+    context.reset();
+
+    std::string counter_name = lbr ? BB_EXEC : UNHALTED_CORE_CYCLES;
+
+    auto filter = get_process_filter(report, config, counter_name);
+    log::emit<log::Debug>() << "Filter by \"" << filter << "\"" << log::endl;
+
+    auto candidates = collect_candidates(report, lbr, filter);
+
+    //Only keep the hottest functions if asked to
+    select_hottest_functions(candidates, config);
+
+    //Only the new spreadsheets are converted
+    convert_functions(report, candidates, data, config, context, lbr);
+
+    prune_uncounted_functions(data);
+
+    //The paths of the previous profile are already stripped, the new functions must be stripped before the merge
+    strip_paths(data);
+
+    //The previous profile is decayed
+    for(auto& function : history.functions){
+        scale_counts(function, decay);
+    }
+
+    prune_uncounted_functions(history);
+
+    log::emit<log::Debug>() << "Merge " << history.functions.size() << " functions of the previous profile, decayed by " << decay << log::endl;
+
+    //The functions of the capture are kept apart like in a plain conversion, even with the same name
+    std::unordered_map<std::size_t, std::string> keys;
+    occurrence_keys(data, 0, data.functions.size(), true, keys);
+
+    merge_functions(data, [&keys](const gooda::afdo_function& function){ return keys.at(function.i); });
+
+    //The previous profile does not record the executables, the nth function of a name in the previous profile is
+    //merged with the nth function of this name in the capture
+    auto captured = data.functions.size();
+    occurrence_keys(data, 0, captured, false, keys);
+
+    std::move(history.functions.begin(), history.functions.end(), std::back_inserter(data.functions));
+    history.functions.clear();
+
+    //The previous functions are not in the spreadsheets, they are indexed after its functions
+    for(auto i = captured; i < data.functions.size(); ++i){
+        data.functions[i].i = report.functions() + (i - captured);
+    }
+
+    occurrence_keys(data, captured, data.functions.size(), false, keys);
+
+    merge_functions(data, [&keys](const gooda::afdo_function& function){ return keys.at(function.i); });
+
+    std::vector<std::pair<uint64_t, uint64_t>> histogram;
+    uint64_t total_count = 0;
+
+    //The instructions of the previous profile are only known by stacks, the working set is computed from the
+    //merged stacks so that the instructions present in both profiles are counted once
+    if(config.working_set){
+        gooda::collect_stack_counts(data, lbr, histogram, total_count);
+    }
+
+    context.statistics().functions = data.functions.size();
+
+    complete_profile(histogram, total_count, data);
+
+    log_statistics(context);
+}
+
+void gooda::convert_perf_to_afdo(const perf_profile& profile, afdo_data& data, const gooda::converter_config& config){
+    gooda::converter_context context;
+
+    convert_perf_to_afdo(profile, data, config, context);
+}
+
+void gooda::convert_perf_to_afdo(const perf_profile& profile, afdo_data& data, const gooda::converter_config& config, converter_context& context){
+    if(config.lbr){
+        throw gooda::gooda_exception("The LBR mode is not supported with perf.data files");
+    }
+
+    //The sampled instructions are not disassembled, the discriminators are not queried
+    if(config.discriminators){
+        throw gooda::gooda_exception("The discriminators are not supported with perf.data files");
+    }
+
+    //Empty the results of the previous conversion
+    context.reset();
+
+    std::vector<gooda::afdo_function> candidates;
+
+    for(std::size_t i = 0; i < profile.functions.size(); ++i){
+        auto& sampled = profile.functions[i];
+
+        gooda::afdo_function function;
+        function.i = i;
+        function.executable_file = sampled.executable_file;
+        function.name = sampled.name;
+
+        for(auto& sample : sampled.samples){
+            function.total_count += sample.second;
+        }
+
+        candidates.push_back(std::move(function));
+    }
+
+    //Only keep the hottest functions if asked to
+    select_hottest_functions(candidates, config);
+
+    function_views views;
+
+    for(auto& function : candidates){
+        auto view = sample_view(profile.functions[function.i]);
+
+        function.entry_count = view.entry_count;
+
+        views[function.i] = std::move(view);
+        data.functions.push_back(std::move(function));
+    }
+
+    auto cache = open_symbol_cache(config, context);
+
+    auto jobs = gooda::thread_count(config.jobs);
+
+    //The names come from the symbol tables, they are already mangled, only the inline stacks are needed
+    fill_inlining_cache(views, data, config, context, cache.get());
+
+    set_sampled_files(data, views, context);
+
+    annotate_functions<cycles_policy>(data, views, context, config, jobs);
+
+    prune_uncounted_functions(data);
+
+    context.statistics().functions = data.functions.size();
+
+    complete_profile(views, data, jobs);
+
+    log_statistics(context);
+}
@@ -0,0 +1,107 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file daemon_context.cpp
+ * \brief Implementation of the state shared by the resident modes of the converter.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "daemon_context.hpp"
+#include "converter.hpp"
+#include "symbol_cache.hpp"
+#include "addr2line.hpp"
+#include "parallel.hpp"
+#include "gooda_exception.hpp"
+
+namespace {
+
+/*!
+ * \brief Indicates that SIGINT or SIGTERM has been received.
+ */
+volatile sig_atomic_t stop_requested = 0;
+
+/*!
+ * \brief The pipe written by the signal handler to wake the daemon.
+ */
+int stop_pipe[2] = {-1, -1};
+
+/*!
+ * \brief Stop the daemon.
+ */
+void stop_daemon(int){
+    stop_requested = 1;
+
+    //The errno of the interrupted code is kept
+    auto error = errno;
+    auto written = write(stop_pipe[1], "", 1);
+    static_cast<void>(written);
+    errno = error;
+}
+
+} //end of anonymous namespace
+
+gooda::daemon_context::daemon_context(const converter_config& config){
+    if(stop_pipe[0] != -1){
+        throw gooda::gooda_exception("Only one daemon can run at a time");
+    }
+
+    pool = std::make_shared<gooda::addr2line_pool>(gooda::thread_count(config.jobs));
+    cache = std::make_shared<gooda::symbol_cache>(config.symcache);
+
+    if(pipe2(stop_pipe, O_CLOEXEC | O_NONBLOCK) == -1){
+        throw gooda::gooda_exception(std::string("Unable to create the stop pipe: ") + strerror(errno));
+    }
+
+    stop_requested = 0;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = stop_daemon;
+    sigaction(SIGINT, &action, &previous_int);
+    sigaction(SIGTERM, &action, &previous_term);
+}
+
+gooda::daemon_context::~daemon_context(){
+    sigaction(SIGINT, &previous_int, nullptr);
+    sigaction(SIGTERM, &previous_term, nullptr);
+
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    stop_pipe[0] = stop_pipe[1] = -1;
+}
+
+bool gooda::daemon_context::stopped() const {
+    return stop_requested;
+}
+
+int gooda::daemon_context::stop_fd() const {
+    return stop_pipe[0];
+}
+
+void gooda::daemon_context::init(converter_context& context) const {
+    context.set_pool(pool);
+    context.set_symbol_cache(cache);
+}
+
+void gooda::daemon_context::block_signals(sigset_t& previous){
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &previous);
+}
+
+void gooda::daemon_context::restore_signals(const sigset_t& previous){
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+}
@@ -16,7 +16,7 @@
 #include "logger.hpp"
 #include "hash.hpp"
 
-void gooda::diff(const gooda_report& first, const gooda_report& second, boost::program_options::variables_map&){
+void gooda::diff(const gooda_report& first, const gooda_report& second, const gooda::converter_config&){
     auto& first_file = first.get_hotspot_file();
     auto& second_file = second.get_hotspot_file();
 
@@ -71,6 +71,29 @@ void gooda::gcov_file::write_string (const std::string& value){
     delete[] buffer;
 }
 
+void gooda::gcov_file::write_file(const std::string& file){
+    log::emit<log::Trace>() << "Write contents of \"" << file << "\"" << log::endl;
+
+    std::ifstream stream(file.c_str(), std::ios::binary | std::ios::in);
+
+    if(!stream){
+        throw gooda::gooda_exception("Cannot open \"" + file + "\" for reading");
+    }
+
+    //An empty file would set the failbit of the output
+    if(stream.peek() != std::ifstream::traits_type::eof()){
+        gcov_file_w << stream.rdbuf();
+    }
+}
+
+void gooda::gcov_file::close(){
+    gcov_file_w.close();
+
+    if(!gcov_file_w){
+        throw gooda::gooda_exception("Cannot write the GCOV file");
+    }
+}
+
 void gooda::gcov_file::write_header(){
     write_unsigned(GCOV_DATA_MAGIC);
     write_unsigned(GCOV_VERSION);
@@ -10,6 +10,8 @@
  * \brief Implementation of gooda_line. 
  */
 
+#include <cctype>
+
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -55,14 +57,26 @@ double gooda::gooda_line::get_double(std::size_t index) const {
 }
 
 long gooda::gooda_line::get_address(std::size_t index) const {
-    auto value = get_string(index);
-    
-    gooda_assert(!value.empty(), "Cannot convert and empty string to an address");
+    auto& item = m_contents[index];
+
+    //Parse directly from the line, this is called for each instruction
+    auto it = item.begin();
+    auto end = item.end();
+
+    while(it != end && isspace(*it)){
+        ++it;
+    }
+
+    gooda_assert(it != end, "Cannot convert and empty string to an address");
+
+    if(end - it > 1 && *it == '0' && (it[1] == 'x' || it[1] == 'X')){
+        it += 2;
+    }
 
-    long x = 0;   
-    std::stringstream ss;
-    ss << std::hex << value;
-    ss >> x;
+    long x = 0;
+    for(; it != end && isxdigit(*it); ++it){
+        x = x * 16 + (isdigit(*it) ? *it - '0' : tolower(*it) - 'a' + 10);
+    }
 
     gooda_assert(x != 0, "Address cannot be zero");
 
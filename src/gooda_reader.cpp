@@ -12,6 +12,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 #include <boost/algorithm/string.hpp>
 
@@ -225,6 +226,35 @@ void read_hotspot(const std::string& directory, gooda::gooda_report& report){
     log::emit<log::Debug>() << "Found " << report.functions() << " hotspot functions" << log::endl;
 }
 
+/*!
+ * \brief Indicates if a spreadsheet file has been completely written.
+ *
+ * Gooda closes each spreadsheet with a line holding a single bracket.
+ *
+ * \param file_name The path to the file.
+ * \return true if the file exists and is complete, false otherwise
+ */
+bool complete_file(const std::string& file_name){
+    std::ifstream file(file_name, std::ios::in | std::ios::binary);
+
+    if(!file.is_open()){
+        return false;
+    }
+
+    //Only the end of the file is needed
+    file.seekg(0, std::ios::end);
+    std::streamoff size = file.tellg();
+    std::streamoff tail = std::min<std::streamoff>(size, 16);
+
+    std::string end(tail, '\0');
+    file.seekg(size - tail);
+    file.read(&end[0], tail);
+
+    boost::trim_right(end);
+
+    return !end.empty() && end.back() == ']';
+}
+
 /*!
  * \brief Read the assembly view file for the given function. 
  * \param directory The spreadsheets directory. 
@@ -260,6 +290,18 @@ void read_src_file(const std::string& directory, std::size_t i, gooda::gooda_rep
 } //end of anonymous namespace
 
 gooda::gooda_report gooda::read_spreadsheets(const std::string& directory){
+    auto report = read_spreadsheet_index(directory);
+
+    //Read the assembly and source views of each hotspot function
+    for(std::size_t i = 0; i < report.functions(); ++i){
+        read_asm_file(directory, i, report);
+        read_src_file(directory, i, report);
+    }
+
+    return report;
+}
+
+gooda::gooda_report gooda::read_spreadsheet_index(const std::string& directory){
     log::emit<log::Debug>() << "Import spreadsheets from " << directory << log::endl;
 
     gooda::gooda_report report;
@@ -268,11 +310,23 @@ gooda::gooda_report gooda::read_spreadsheets(const std::string& directory){
     read_processes(directory, report);
     read_hotspot(directory, report);
 
-    //Read the assembly and source views of each hotspot function
-    for(std::size_t i = 0; i < report.functions(); ++i){
-        read_asm_file(directory, i, report);
-        read_src_file(directory, i, report);
-    }
-
     return report;
 }
+
+bool gooda::read_asm_view(const std::string& directory, std::size_t i, gooda_report& report){
+    read_asm_file(directory, i, report);
+
+    return report.has_asm_file(i);
+}
+
+bool gooda::has_asm_view(const std::string& directory, std::size_t i){
+    return gooda::exists(directory + ASM_FOLDER + std::to_string(i) + ASM_CSV);
+}
+
+bool gooda::spreadsheet_index_complete(const std::string& directory){
+    return complete_file(directory + PROCESS_CSV) && complete_file(directory + HOTSPOT_CSV);
+}
+
+bool gooda::asm_view_complete(const std::string& directory, std::size_t i){
+    return complete_file(directory + ASM_FOLDER + std::to_string(i) + ASM_CSV);
+}
@@ -44,6 +44,10 @@ bool gooda::gooda_report::has_asm_file(std::size_t i) const {
     return asm_files.find(i) != asm_files.end();
 }
 
+void gooda::gooda_report::release_asm_file(std::size_t i){
+    asm_files.erase(i);
+}
+
 gooda::gooda_line& gooda::gooda_report::new_process(){
     return process_file.new_line();
 }
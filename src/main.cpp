@@ -12,9 +12,15 @@
 
 #include <iostream>
 #include <chrono>
+#include <map>
+#include <memory>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 
 #include "utils.hpp"
 #include "gooda_reader.hpp"
+#include "perf_reader.hpp"
 #include "converter.hpp"
 #include "afdo_generator.hpp"
 #include "afdo_printer.hpp"
@@ -22,6 +28,11 @@
 #include "logger.hpp"
 #include "diff.hpp"
 #include "afdo_diff.hpp"
+#include "working_set.hpp"
+#include "server.hpp"
+#include "watcher.hpp"
+#include "result_cache.hpp"
+#include "parallel.hpp"
 #include "Options.hpp"
 #include "gooda_exception.hpp"
 
@@ -39,29 +50,145 @@ typedef std::chrono::high_resolution_clock Clock;
  */
 typedef std::chrono::milliseconds milliseconds;
 
+/*!
+ * \brief Process the Gooda spreadsheets, generating one AFDO profile per process or per module
+ * \param report The Gooda report
+ * \param vm The configuration
+ */
+void process_spreadsheets_split(const gooda::gooda_report& report, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
+    std::map<std::string, gooda::afdo_data> profiles;
+
+    //Convert the Gooda report to one AFDO profile per partition
+    if(vm.count("split-by-module")){
+        gooda::convert_to_afdo_by_module(report, profiles, config);
+    } else {
+        gooda::convert_to_afdo_by_process(report, profiles, config);
+    }
+
+    //Execute the specified action
+    if(vm.count("dump") || vm.count("full-dump")){
+        for(auto& profile : profiles){
+            std::cout << (vm.count("split-by-module") ? "Module " : "Process ") << profile.first << std::endl;
+
+            if(vm.count("dump")){
+                gooda::dump_afdo_light(profile.second, config);
+            } else {
+                gooda::dump_afdo(profile.second, config);
+            }
+        }
+    } else {
+        std::vector<std::string> partitions;
+        for(auto& profile : profiles){
+            partitions.push_back(profile.first);
+        }
+
+        //Each profile has its own file, even if the names of two partitions have the same safe form
+        auto files = gooda::partition_outputs(vm["output"].as<std::string>(), partitions);
+
+        std::vector<std::pair<std::string, const gooda::afdo_data*>> outputs;
+        for(auto& profile : profiles){
+            outputs.emplace_back(files[outputs.size()], &profile.second);
+        }
+
+        //The profiles are independent, they are written concurrently
+        gooda::parallel_for_each(outputs.size(), gooda::thread_count(config.jobs), [&](std::size_t i){
+            gooda::generate_afdo(*outputs[i].second, outputs[i].first, config);
+        });
+    }
+}
+
 /*!
  * \brief Process the Gooda spreadsheets
  * \param directory The spreadsheets directory
  * \param vm The configuration
  */
 void process_spreadsheets(const std::string& directory, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
     Clock::time_point t0 = Clock::now();
 
+    //The same spreadsheets may have been converted before
+    std::unique_ptr<gooda::result_cache> cache;
+    std::string key;
+
+    if(vm.count("result-cache")){
+        cache.reset(new gooda::result_cache(vm["result-cache"].as<std::string>()));
+        key = cache->key(directory, config);
+
+        if(cache->fetch(key, config, vm["output"].as<std::string>())){
+            milliseconds ms = std::chrono::duration_cast<milliseconds>(Clock::now() - t0);
+            log::emit<log::Debug>() << "Conversion took " << ms.count() << "ms (cached)" << log::endl;
+
+            return;
+        }
+    }
+
     //Read the Gooda Spreadsheets
     auto report = gooda::read_spreadsheets(directory);
 
+    if(vm.count("split-by-process") || vm.count("split-by-module")){
+        process_spreadsheets_split(report, vm);
+    } else {
+        gooda::afdo_data data;
+
+        if(vm.count("update-from")){
+            gooda::afdo_data history;
+            gooda::read_afdo(vm["update-from"].as<std::string>(), history, config);
+
+            //Merge the Gooda report into the decayed previous profile
+            gooda::update_to_afdo(report, history, vm.count("decay") ? vm["decay"].as<double>() : 0.5, data, config);
+        } else {
+            //Convert the Gooda report to AFDO
+            gooda::convert_to_afdo(report, data, config);
+        }
+
+        //Execute the specified action
+        if(vm.count("dump")){
+            gooda::dump_afdo_light(data, config);
+        } else if(vm.count("full-dump")){
+            gooda::dump_afdo(data, config);
+        } else {
+            gooda::generate_afdo(data, vm["output"].as<std::string>(), config);
+
+            if(cache){
+                cache->store(key, data, config, vm["output"].as<std::string>());
+            }
+        }
+    }
+
+    Clock::time_point t1 = Clock::now();
+    milliseconds ms = std::chrono::duration_cast<milliseconds>(t1 - t0);
+
+    log::emit<log::Debug>() << "Conversion took " << ms.count() << "ms" << log::endl;
+}
+
+/*!
+ * \brief Process the samples of a perf.data file
+ * \param file The perf.data file
+ * \param vm The configuration
+ */
+void process_perf_data(const std::string& file, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
+    Clock::time_point t0 = Clock::now();
+
+    //Read the samples, resolved to the functions of the ELF files
+    auto profile = gooda::read_perf_data(file, config);
+
     gooda::afdo_data data;
 
-    //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, vm);
+    //Convert the samples to AFDO
+    gooda::convert_perf_to_afdo(profile, data, config);
 
     //Execute the specified action
     if(vm.count("dump")){
-        gooda::dump_afdo_light(data, vm);
+        gooda::dump_afdo_light(data, config);
     } else if(vm.count("full-dump")){
-        gooda::dump_afdo(data, vm);
+        gooda::dump_afdo(data, config);
     } else {
-        gooda::generate_afdo(data, vm["output"].as<std::string>(), vm);
+        gooda::generate_afdo(data, vm["output"].as<std::string>(), config);
     }
 
     Clock::time_point t1 = Clock::now();
@@ -70,6 +197,79 @@ void process_spreadsheets(const std::string& directory, po::variables_map& vm){
     log::emit<log::Debug>() << "Conversion took " << ms.count() << "ms" << log::endl;
 }
 
+/*!
+ * \brief Convert the Gooda spreadsheets to an AFDO file one function at a time
+ * \param directory The spreadsheets directory
+ * \param vm The configuration
+ */
+void stream_spreadsheets(const std::string& directory, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
+    Clock::time_point t0 = Clock::now();
+
+    //The assembly views are read, converted and released one at a time
+    gooda::stream_to_afdo(directory, vm["output"].as<std::string>(), config);
+
+    Clock::time_point t1 = Clock::now();
+    milliseconds ms = std::chrono::duration_cast<milliseconds>(t1 - t0);
+
+    log::emit<log::Debug>() << "Streamed conversion took " << ms.count() << "ms" << log::endl;
+}
+
+/*!
+ * \brief Aggregate several sets of spreadsheets into a single AFDO profile
+ * \param directories The spreadsheets directories
+ * \param vm The configuration
+ */
+void aggregate(const std::vector<std::string>& directories, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
+    Clock::time_point t0 = Clock::now();
+
+    std::vector<double> weights;
+
+    if(vm.count("weights")){
+        std::vector<std::string> values;
+        auto str_weights = vm["weights"].as<std::string>();
+        boost::split(values, str_weights, [](char c){ return c == ','; });
+
+        for(auto& value : values){
+            double weight;
+            if(!boost::conversion::try_lexical_convert(boost::trim_copy(value), weight) || weight < 0.0){
+                throw gooda::gooda_exception("Invalid weight \"" + value + "\"");
+            }
+
+            weights.push_back(weight);
+        }
+    }
+
+    //Read the Gooda Spreadsheets concurrently
+    std::vector<gooda::gooda_report> reports(directories.size());
+
+    gooda::parallel_for_each(directories.size(), gooda::thread_count(config.jobs), [&](std::size_t i){
+        reports[i] = gooda::read_spreadsheets(directories[i]);
+    });
+
+    gooda::afdo_data data;
+
+    //Convert the Gooda reports to a single AFDO profile
+    gooda::aggregate_to_afdo(reports, weights, data, config);
+
+    //Execute the specified action
+    if(vm.count("dump")){
+        gooda::dump_afdo_light(data, config);
+    } else if(vm.count("full-dump")){
+        gooda::dump_afdo(data, config);
+    } else {
+        gooda::generate_afdo(data, vm["output"].as<std::string>(), config);
+    }
+
+    Clock::time_point t1 = Clock::now();
+    milliseconds ms = std::chrono::duration_cast<milliseconds>(t1 - t0);
+
+    log::emit<log::Debug>() << "Aggregation took " << ms.count() << "ms" << log::endl;
+}
+
 /*!
  * \brief Generate the difference between two sets of spreadsheets
  * \param first The path to the first spreadsheets directory. 
@@ -77,13 +277,15 @@ void process_spreadsheets(const std::string& directory, po::variables_map& vm){
  * \param vm The configuration
  */
 void diff(const std::string& first, const std::string& second, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
     Clock::time_point t0 = Clock::now();
 
     //Read the Gooda Spreadsheets
     auto first_report = gooda::read_spreadsheets(first);
     auto second_report = gooda::read_spreadsheets(second);
 
-    diff(first_report, second_report, vm);
+    diff(first_report, second_report, config);
     
     Clock::time_point t1 = Clock::now();
     milliseconds ms = std::chrono::duration_cast<milliseconds>(t1 - t0);
@@ -98,21 +300,23 @@ void diff(const std::string& first, const std::string& second, po::variables_map
  * \param vm The configuration
  */
 void afdo_diff(const std::string& first, const std::string& second, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
     Clock::time_point t0 = Clock::now();
     
     gooda::afdo_data data_first;
     gooda::afdo_data data_second;
 
     
-    gooda::read_afdo(first, data_first, vm);
-    gooda::read_afdo(second, data_second, vm);
+    gooda::read_afdo(first, data_first, config);
+    gooda::read_afdo(second, data_second, config);
     
     std::cout << "Diff of AFDO profiles" << std::endl;
     std::cout << "   First: " << first << std::endl;
     std::cout << "   Second: " << second << std::endl;
     std::cout << std::endl;
 
-    afdo_diff(data_first, data_second, vm);
+    afdo_diff(data_first, data_second, config);
     
     Clock::time_point t1 = Clock::now();
     milliseconds ms = std::chrono::duration_cast<milliseconds>(t1 - t0);
@@ -126,6 +330,8 @@ void afdo_diff(const std::string& first, const std::string& second, po::variable
  * \param vm The configuration
  */
 void process_afdo(const std::string& afdo_file, po::variables_map& vm){
+    auto config = gooda::make_config(vm);
+
     Clock::time_point t0 = Clock::now();
 
     log::emit<log::Debug>() << "Start reading " << afdo_file << log::endl;
@@ -133,14 +339,28 @@ void process_afdo(const std::string& afdo_file, po::variables_map& vm){
     gooda::afdo_data data;
 
     //Read the AFDO file into data structure
-    gooda::read_afdo(afdo_file, data, vm);
+    gooda::read_afdo(afdo_file, data, config);
+
+    //Rebuild the working set from the function profile
+    if(vm.count("recompute-ws")){
+        //The profile is read entirely before it is written, but a failed write would lose it
+        if(gooda::same_file(afdo_file, vm["output"].as<std::string>())){
+            throw gooda::gooda_exception("The profile rebuilt with --recompute-ws cannot overwrite \"" + afdo_file + "\"");
+        }
+
+        gooda::recompute_working_set(data, config.lbr);
+    }
 
     if(vm.count("dump")){
-        gooda::dump_afdo_light(data, vm);
-    } 
+        gooda::dump_afdo_light(data, config);
+    } else if(vm.count("full-dump")){
+        gooda::dump_afdo(data, config);
+    } else if(vm.count("recompute-ws")){
+        gooda::generate_afdo(data, vm["output"].as<std::string>(), config);
+    }
     //The default option is to print the full dump
     else {
-        gooda::dump_afdo(data, vm);
+        gooda::dump_afdo(data, config);
     }
     
     Clock::time_point t1 = Clock::now();
@@ -223,6 +443,15 @@ void profile_application(po::variables_map& vm, po::parsed_options& parsed_optio
 
     gooda::exec_command(profile_command);
 
+    //The samples recorded by perf are converted directly, without Gooda
+    if(vm.count("read-perf")){
+        if(vm.count("afdo") || vm.count("dump") || vm.count("full-dump")){
+            process_perf_data("perf.data", vm);
+        }
+
+        return;
+    }
+
     std::string gooda_command;
     if(vm.count("gooda")){
         gooda_command = "sudo " + vm["gooda"].as<std::string>() + "/gooda";
@@ -261,6 +490,9 @@ int main(int argc, const char **argv){
         gooda::options options;
         options.parse(argc, argv);
 
+        //The logging level is global, it is only set from the command line of the converter
+        log::set_level(options.vm["log"].as<int>());
+
         //Profiling mode
         if(options.vm.count("profile")){
             profile_application(options.vm, options.parsed_options);
@@ -271,6 +503,17 @@ int main(int argc, const char **argv){
 
         auto& vm = options.vm;
 
+        //Daemon mode
+        if(vm.count("serve")){
+            gooda::serve(vm["serve"].as<std::string>(), gooda::make_config(vm));
+            return 0;
+        }
+
+        if(vm.count("watch")){
+            gooda::watch(vm["watch"].as<std::string>(), vm["output"].as<std::string>(), gooda::make_config(vm));
+            return 0;
+        }
+
         if(!vm.count("input-file")){
             log::emit<log::Error>() << "No file provided" << log::endl;
 
@@ -363,6 +606,25 @@ int main(int argc, const char **argv){
             //Perform the diff
             afdo_diff(first, second, vm);
 
+            return 0;
+        } else if(vm.count("aggregate")){
+            for(auto& input_file : input_files){
+                //The directories must exists
+                if(!gooda::exists(input_file)){
+                    log::emit<log::Error>() << "\"" << input_file << "\" does not exists" << log::endl;
+                    return 1;
+                }
+
+                //The file must be a directory
+                if(!gooda::is_directory(input_file)){
+                    log::emit<log::Error>() << "\"" << input_file << "\" is not a directory" << log::endl;
+                    return 1;
+                }
+            }
+
+            //Perform the aggregation
+            aggregate(input_files, vm);
+
             return 0;
         } else {
             //Verify that only one directory is provided
@@ -382,6 +644,14 @@ int main(int argc, const char **argv){
 
             if(vm.count("read-afdo")){
                 process_afdo(input_file, vm); 
+            } else if(vm.count("read-perf")){
+                //The file must be a file
+                if(gooda::is_directory(input_file)){
+                    log::emit<log::Error>() << "\"" << input_file << "\" is not a file" << log::endl;
+                    return 1;
+                }
+
+                process_perf_data(input_file, vm);
             } 
             //By default, read spreadsheets
             else {
@@ -391,7 +661,11 @@ int main(int argc, const char **argv){
                     return 1;
                 }
 
-                process_spreadsheets(input_file, vm);
+                if(vm.count("stream")){
+                    stream_spreadsheets(input_file, vm);
+                } else {
+                    process_spreadsheets(input_file, vm);
+                }
             }
         }
     } catch (const gooda::gooda_exception& e){
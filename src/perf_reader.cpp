@@ -0,0 +1,847 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file perf_reader.cpp
+ * \brief Implementation of the reading of the samples of perf.data files.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <cerrno>
+#include <cstring>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/perf_event.h>
+
+#include "perf_reader.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+#include "gooda_exception.hpp"
+
+namespace {
+
+/*!
+ * \brief The magic number of the perf.data files ("PERFILE2"), in the native byte order.
+ */
+const uint64_t PERF_MAGIC = 0x32454c4946524550ULL;
+
+/*!
+ * \struct perf_file_section
+ * \brief The position of a section of a perf.data file.
+ */
+struct perf_file_section {
+    uint64_t offset;            //!< The position of the section
+    uint64_t size;              //!< The size of the section
+};
+
+/*!
+ * \struct perf_file_header
+ * \brief The header of a perf.data file.
+ */
+struct perf_file_header {
+    uint64_t magic;                     //!< The magic number
+    uint64_t size;                      //!< The size of the header
+    uint64_t attr_size;                 //!< The size of each entry of the attributes section
+    perf_file_section attrs;            //!< The attributes of the events
+    perf_file_section data;             //!< The records
+    perf_file_section event_types;      //!< Unused
+    uint64_t features[4];               //!< The bitmap of the optional sections
+};
+
+/*!
+ * \class mapped_file
+ * \brief A file mapped in memory, read-only.
+ */
+class mapped_file {
+    public:
+        /*!
+         * \brief Map the given file.
+         * \param file The path to the file.
+         */
+        explicit mapped_file(const std::string& file){
+            auto fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+
+            if(fd == -1){
+                throw gooda::gooda_exception("Unable to open \"" + file + "\"");
+            }
+
+            struct stat st;
+            if(fstat(fd, &st) == -1){
+                auto error = strerror(errno);
+                close(fd);
+
+                throw gooda::gooda_exception("Unable to read \"" + file + "\": " + error);
+            }
+
+            size = st.st_size;
+
+            if(size > 0){
+                auto address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if(address == MAP_FAILED){
+                    auto error = strerror(errno);
+                    close(fd);
+
+                    throw gooda::gooda_exception("Unable to map \"" + file + "\": " + error);
+                }
+
+                data = static_cast<const char*>(address);
+            }
+
+            close(fd);
+        }
+
+        /*!
+         * \brief Unmap the file.
+         */
+        ~mapped_file(){
+            if(data){
+                munmap(const_cast<char*>(data), size);
+            }
+        }
+
+        /*!
+         * \brief Deleted copy constructor
+         * \param other The other mapped file
+         */
+        mapped_file(const mapped_file& other) = delete;
+
+        /*!
+         * \brief Deleted copy assignment operator
+         * \param other The other mapped file
+         * \return A reference to this
+         */
+        mapped_file& operator=(const mapped_file& other) = delete;
+
+        /*!
+         * \brief Indicates if a section is entirely contained in the file.
+         * \param section The section.
+         * \return true if the section is in the file, false otherwise.
+         */
+        bool contains(const perf_file_section& section) const {
+            return section.offset <= size && section.size <= size - section.offset;
+        }
+
+        const char* data = nullptr;     //!< The content of the file
+        std::size_t size = 0;           //!< The size of the file
+};
+
+/*!
+ * \struct perf_mapping
+ * \brief An executable memory mapping of a process.
+ */
+struct perf_mapping {
+    uint64_t end;               //!< The end of the mapping
+    uint64_t pgoff;             //!< The offset of the mapping in the file
+    std::size_t executable;     //!< The index of the mapped ELF file
+};
+
+/*!
+ * \typedef process_mappings
+ * \brief The executable memory mappings of a process, by start address
+ */
+typedef std::map<uint64_t, perf_mapping> process_mappings;
+
+/*!
+ * \struct elf_segment
+ * \brief A loadable segment of an ELF file.
+ */
+struct elf_segment {
+    uint64_t offset;            //!< The position of the segment in the file
+    uint64_t size;              //!< The size of the segment in the file
+    uint64_t address;           //!< The virtual address of the segment
+};
+
+/*!
+ * \struct elf_function
+ * \brief A function symbol of an ELF file.
+ */
+struct elf_function {
+    uint64_t address;           //!< The address of the function
+    uint64_t size;              //!< The size of the function
+    int rank;                   //!< The preference of the symbol among the symbols of the same address (global first)
+    std::string name;           //!< The name of the symbol
+};
+
+/*!
+ * \brief Read a value from a record.
+ * \param record The record.
+ * \param offset The position of the value in the record, moved after the value.
+ * \param size The size of the record.
+ * \param value The value.
+ * \tparam T The type of the value.
+ * \return true if the record contains the value, false otherwise.
+ */
+template<typename T>
+bool read_value(const char* record, std::size_t& offset, std::size_t size, T& value){
+    if(offset + sizeof(T) > size){
+        return false;
+    }
+
+    memcpy(&value, record + offset, sizeof(T));
+    offset += sizeof(T);
+
+    return true;
+}
+
+/*!
+ * \brief Read an ELF structure at the given position.
+ * \param stream The ELF file.
+ * \param offset The position of the structure.
+ * \param value The structure.
+ * \tparam T The type of the structure.
+ * \return true if the structure has been read, false otherwise.
+ */
+template<typename T>
+bool read_struct(std::ifstream& stream, uint64_t offset, T& value){
+    stream.clear();
+    stream.seekg(offset);
+
+    return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+/*!
+ * \brief Read the loadable segments and the function symbols of an ELF file.
+ *
+ * The symbols are read from the symbol table, or from the dynamic symbol table if the file is stripped.
+ *
+ * \param stream The ELF file.
+ * \param file_size The size of the ELF file.
+ * \param segments The loadable segments.
+ * \param functions The function symbols.
+ * \tparam Ehdr The type of the ELF header.
+ * \tparam Shdr The type of the section headers.
+ * \tparam Phdr The type of the program headers.
+ * \tparam Sym The type of the symbols.
+ */
+template<typename Ehdr, typename Shdr, typename Phdr, typename Sym>
+void read_elf(std::ifstream& stream, uint64_t file_size, std::vector<elf_segment>& segments, std::vector<elf_function>& functions){
+    Ehdr header;
+    if(!read_struct(stream, 0, header)){
+        return;
+    }
+
+    for(std::size_t i = 0; i < header.e_phnum && header.e_phentsize >= sizeof(Phdr); ++i){
+        Phdr segment;
+        if(!read_struct(stream, header.e_phoff + i * header.e_phentsize, segment)){
+            break;
+        }
+
+        if(segment.p_type == PT_LOAD){
+            segments.push_back({segment.p_offset, segment.p_filesz, segment.p_vaddr});
+        }
+    }
+
+    std::vector<Shdr> sections;
+    for(std::size_t i = 0; i < header.e_shnum && header.e_shentsize >= sizeof(Shdr); ++i){
+        Shdr section;
+        if(!read_struct(stream, header.e_shoff + i * header.e_shentsize, section)){
+            break;
+        }
+
+        sections.push_back(section);
+    }
+
+    //The full symbol table is preferred to the dynamic one
+    const Shdr* symtab = nullptr;
+    for(auto type : {SHT_SYMTAB, SHT_DYNSYM}){
+        for(auto& section : sections){
+            if(!symtab && section.sh_type == static_cast<decltype(section.sh_type)>(type) && section.sh_link < sections.size()){
+                symtab = &section;
+            }
+        }
+    }
+
+    if(!symtab){
+        return;
+    }
+
+    auto& strtab = sections[symtab->sh_link];
+
+    //The sizes of the tables come from the file, they are checked before being used
+    if(symtab->sh_offset > file_size || symtab->sh_size > file_size - symtab->sh_offset
+            || strtab.sh_offset > file_size || strtab.sh_size > file_size - strtab.sh_offset){
+        return;
+    }
+
+    std::vector<char> strings(strtab.sh_size + 1, '\0');
+    stream.clear();
+    stream.seekg(strtab.sh_offset);
+    if(!stream.read(strings.data(), strtab.sh_size)){
+        return;
+    }
+
+    std::vector<Sym> symbols(symtab->sh_size / sizeof(Sym));
+    stream.clear();
+    stream.seekg(symtab->sh_offset);
+    if(!stream.read(reinterpret_cast<char*>(symbols.data()), symbols.size() * sizeof(Sym))){
+        return;
+    }
+
+    for(auto& symbol : symbols){
+        auto type = symbol.st_info & 0xF;
+        auto bind = symbol.st_info >> 4;
+
+        if((type == STT_FUNC || type == STT_GNU_IFUNC) && symbol.st_shndx != SHN_UNDEF && symbol.st_size > 0 && symbol.st_name < strtab.sh_size){
+            int rank = bind == STB_GLOBAL ? 0 : bind == STB_WEAK ? 1 : 2;
+            functions.push_back({symbol.st_value, symbol.st_size, rank, &strings[symbol.st_name]});
+        }
+    }
+}
+
+/*!
+ * \brief Read the loadable segments and the function symbols of an ELF file.
+ * \param file The path to the ELF file.
+ * \param segments The loadable segments.
+ * \param functions The function symbols, by increasing address, one per address.
+ * \return true if the file is an ELF file that could be read, false otherwise.
+ */
+bool read_elf_file(const std::string& file, std::vector<elf_segment>& segments, std::vector<elf_function>& functions){
+    std::ifstream stream(file, std::ios::in | std::ios::binary);
+
+    if(!stream){
+        return false;
+    }
+
+    stream.seekg(0, std::ios::end);
+    uint64_t file_size = stream.tellg();
+    stream.seekg(0);
+
+    unsigned char ident[EI_NIDENT];
+    if(!stream.read(reinterpret_cast<char*>(ident), EI_NIDENT) || memcmp(ident, ELFMAG, SELFMAG) != 0){
+        return false;
+    }
+
+    //Only the native little endian files are supported
+    if(ident[EI_DATA] != ELFDATA2LSB){
+        return false;
+    }
+
+    if(ident[EI_CLASS] == ELFCLASS64){
+        read_elf<Elf64_Ehdr, Elf64_Shdr, Elf64_Phdr, Elf64_Sym>(stream, file_size, segments, functions);
+    } else if(ident[EI_CLASS] == ELFCLASS32){
+        read_elf<Elf32_Ehdr, Elf32_Shdr, Elf32_Phdr, Elf32_Sym>(stream, file_size, segments, functions);
+    } else {
+        return false;
+    }
+
+    //Keep the preferred symbol of each address
+    std::sort(functions.begin(), functions.end(), [](const elf_function& lhs, const elf_function& rhs){
+        return lhs.address < rhs.address || (lhs.address == rhs.address && lhs.rank < rhs.rank);
+    });
+
+    functions.erase(std::unique(functions.begin(), functions.end(), [](const elf_function& lhs, const elf_function& rhs){
+        return lhs.address == rhs.address;
+    }), functions.end());
+
+    return true;
+}
+
+/*!
+ * \brief Indicates if the attributes describe the cycles event.
+ * \param attr The attributes of the event.
+ * \return true if the event counts the unhalted core cycles, false otherwise.
+ */
+bool cycles_event(const perf_event_attr& attr){
+    return (attr.type == PERF_TYPE_HARDWARE && attr.config == PERF_COUNT_HW_CPU_CYCLES)
+        || (attr.type == PERF_TYPE_RAW && (attr.config & 0xFFFF) == 0x3C);
+}
+
+/*!
+ * \brief Add an executable memory mapping to a process, replacing the mappings it overlaps.
+ * \param mappings The mappings of the process.
+ * \param start The start address of the mapping.
+ * \param mapping The mapping.
+ */
+void add_mapping(process_mappings& mappings, uint64_t start, const perf_mapping& mapping){
+    auto it = mappings.lower_bound(start);
+
+    if(it != mappings.begin() && std::prev(it)->second.end > start){
+        --it;
+    }
+
+    while(it != mappings.end() && it->first < mapping.end){
+        it = mappings.erase(it);
+    }
+
+    mappings[start] = mapping;
+}
+
+/*!
+ * \struct sample_count
+ * \brief The samples of an address.
+ */
+struct sample_count {
+    uint64_t samples = 0;       //!< The number of samples
+    uint64_t weight = 0;        //!< The sum of the periods of the samples
+};
+
+/*!
+ * \struct perf_record
+ * \brief A record of the data section, with its time.
+ */
+struct perf_record {
+    uint64_t time;              //!< The time of the record
+    uint64_t position;          //!< The position of the record in the data section
+};
+
+/*!
+ * \struct perf_samples
+ * \brief The samples of a perf.data file, by ELF file and by offset in the file.
+ */
+struct perf_samples {
+    std::vector<std::string> executables;                                       //!< The mapped ELF files
+    std::unordered_map<std::string, std::size_t> executable_ids;                //!< The index of each mapped ELF file
+    std::vector<std::unordered_map<uint64_t, sample_count>> offsets;            //!< The samples of each ELF file, by offset
+    std::unordered_map<uint32_t, process_mappings> processes;                   //!< The mappings of each process
+
+    /*!
+     * \brief Return the index of an ELF file.
+     * \param executable The ELF file
+     * \return The index of the ELF file
+     */
+    std::size_t executable_id(const std::string& executable){
+        auto it = executable_ids.find(executable);
+
+        if(it != executable_ids.end()){
+            return it->second;
+        }
+
+        executables.push_back(executable);
+        offsets.emplace_back();
+
+        return executable_ids[executable] = executables.size() - 1;
+    }
+
+    /*!
+     * \brief Add an executable memory mapping.
+     * \param pid The process
+     * \param start The start address of the mapping
+     * \param length The length of the mapping
+     * \param pgoff The offset of the mapping in the file
+     * \param file The mapped file
+     */
+    void map(uint32_t pid, uint64_t start, uint64_t length, uint64_t pgoff, const std::string& file){
+        //The anonymous and special mappings ([vdso], [heap], //anon, ...) have no ELF file
+        if(file.empty() || file[0] == '[' || file.compare(0, 2, "//") == 0){
+            return;
+        }
+
+        add_mapping(processes[pid], start, {start + length, pgoff, executable_id(file)});
+    }
+};
+
+/*!
+ * \brief Return the size of the identification fields appended to the records other than the samples.
+ * \param sample_type The layout of the samples.
+ * \return The size of the sample_id fields.
+ */
+std::size_t sample_id_size(uint64_t sample_type){
+    std::size_t size = 0;
+
+    for(uint64_t field : {PERF_SAMPLE_TID, PERF_SAMPLE_TIME, PERF_SAMPLE_ID, PERF_SAMPLE_STREAM_ID, PERF_SAMPLE_CPU, PERF_SAMPLE_IDENTIFIER}){
+        if(sample_type & field){
+            size += sizeof(uint64_t);
+        }
+    }
+
+    return size;
+}
+
+/*!
+ * \brief Read the time of a record.
+ *
+ * The time of a sample is one of its fields. The other records of the kernel only have a time
+ * if the event was recorded with sample_id_all, in the fields appended to the record.
+ *
+ * \param event The header of the record.
+ * \param data The content of the record, after its header.
+ * \param size The size of the content of the record.
+ * \param attr The attributes of the sampled event.
+ * \param time The time of the record.
+ * \return true if the record has a time, false otherwise.
+ */
+bool record_time(const perf_event_header& event, const char* data, std::size_t size, const perf_event_attr& attr, uint64_t& time){
+    if(!(attr.sample_type & PERF_SAMPLE_TIME)){
+        return false;
+    }
+
+    std::size_t offset = 0;
+
+    if(event.type == PERF_RECORD_SAMPLE){
+        for(uint64_t field : {PERF_SAMPLE_IDENTIFIER, PERF_SAMPLE_IP, PERF_SAMPLE_TID}){
+            if(attr.sample_type & field){
+                offset += sizeof(uint64_t);
+            }
+        }
+    } else if(attr.sample_id_all && event.type < PERF_RECORD_MAX && size >= sample_id_size(attr.sample_type)){
+        offset = size - sample_id_size(attr.sample_type);
+
+        if(attr.sample_type & PERF_SAMPLE_TID){
+            offset += sizeof(uint64_t);
+        }
+    } else {
+        return false;
+    }
+
+    return read_value(data, offset, size, time);
+}
+
+/*!
+ * \brief Process a record of the perf.data file.
+ * \param event The header of the record.
+ * \param data The content of the record, after its header.
+ * \param size The size of the content of the record.
+ * \param sample_type The layout of the samples.
+ * \param ids The identifiers of the sampled event, empty if all the samples are kept.
+ * \param samples The samples to fill.
+ * \param profile The profile, receiving the number of samples.
+ */
+void process_record(const perf_event_header& event, const char* data, std::size_t size, uint64_t sample_type, const std::vector<uint64_t>& ids, perf_samples& samples, gooda::perf_profile& profile){
+    std::size_t offset = 0;
+
+    if(event.type == PERF_RECORD_MMAP || event.type == PERF_RECORD_MMAP2){
+        uint32_t pid;
+        uint32_t tid;
+        uint64_t start;
+        uint64_t length;
+        uint64_t pgoff;
+
+        if(!(read_value(data, offset, size, pid) && read_value(data, offset, size, tid) && read_value(data, offset, size, start)
+                && read_value(data, offset, size, length) && read_value(data, offset, size, pgoff))){
+            return;
+        }
+
+        bool executable = true;
+
+        if(event.type == PERF_RECORD_MMAP2){
+            uint32_t prot = 0;
+
+            //Skip the device or the build-id of the file
+            offset += 24;
+
+            executable = read_value(data, offset, size, prot) && (prot & PROT_EXEC);
+            offset += sizeof(uint32_t);
+        } else {
+            executable = !(event.misc & PERF_RECORD_MISC_MMAP_DATA);
+        }
+
+        if(executable && offset < size){
+            samples.map(pid, start, length, pgoff, std::string(data + offset, strnlen(data + offset, size - offset)));
+        }
+    } else if(event.type == PERF_RECORD_FORK){
+        uint32_t pid;
+        uint32_t ppid;
+
+        //A new process starts with the mappings of its parent
+        if(read_value(data, offset, size, pid) && read_value(data, offset, size, ppid) && pid != ppid && !samples.processes.count(pid)){
+            auto parent = samples.processes.find(ppid);
+
+            if(parent != samples.processes.end()){
+                samples.processes[pid] = parent->second;
+            }
+        }
+    } else if(event.type == PERF_RECORD_COMM){
+        uint32_t pid;
+
+        //The mappings of an exec'ed process are replaced
+        if((event.misc & PERF_RECORD_MISC_COMM_EXEC) && read_value(data, offset, size, pid)){
+            samples.processes.erase(pid);
+        }
+    } else if(event.type == PERF_RECORD_SAMPLE){
+        //Only the samples of the user code are resolved
+        if((event.misc & PERF_RECORD_MISC_CPUMODE_MASK) != PERF_RECORD_MISC_USER){
+            return;
+        }
+
+        uint64_t id = 0;
+        uint64_t ip = 0;
+        uint32_t pid = 0;
+        uint32_t tid = 0;
+        uint64_t period = 1;
+        uint64_t unused;
+
+        bool valid = true;
+
+        //The fields are in the order of their bits, except the identifier which comes first
+
+        if(sample_type & PERF_SAMPLE_IDENTIFIER){
+            valid = valid && read_value(data, offset, size, id);
+        }
+
+        valid = valid && read_value(data, offset, size, ip) && read_value(data, offset, size, pid) && read_value(data, offset, size, tid);
+
+        if(sample_type & PERF_SAMPLE_TIME){
+            valid = valid && read_value(data, offset, size, unused);
+        }
+
+        if(sample_type & PERF_SAMPLE_ADDR){
+            valid = valid && read_value(data, offset, size, unused);
+        }
+
+        if(!(sample_type & PERF_SAMPLE_IDENTIFIER) && (sample_type & PERF_SAMPLE_ID)){
+            valid = valid && read_value(data, offset, size, id);
+        }
+
+        if(sample_type & PERF_SAMPLE_STREAM_ID){
+            valid = valid && read_value(data, offset, size, unused);
+        }
+
+        //The CPU and a reserved field
+        if(sample_type & PERF_SAMPLE_CPU){
+            valid = valid && read_value(data, offset, size, unused);
+        }
+
+        //With a frequency, each sample stands for a different number of events
+        if(sample_type & PERF_SAMPLE_PERIOD){
+            valid = valid && read_value(data, offset, size, period);
+        }
+
+        if(!valid || (!ids.empty() && std::find(ids.begin(), ids.end(), id) == ids.end())){
+            return;
+        }
+
+        ++profile.samples;
+
+        auto process = samples.processes.find(pid);
+        if(process == samples.processes.end()){
+            ++profile.unresolved;
+            return;
+        }
+
+        auto& mappings = process->second;
+
+        auto it = mappings.upper_bound(ip);
+        if(it == mappings.begin() || std::prev(it)->second.end <= ip){
+            ++profile.unresolved;
+            return;
+        }
+
+        --it;
+
+        auto& count = samples.offsets[it->second.executable][ip - it->first + it->second.pgoff];
+        ++count.samples;
+        count.weight += period;
+    }
+}
+
+/*!
+ * \brief Read the records of the perf.data file and count the samples of the event by ELF file and offset.
+ *
+ * perf writes the buffers of the CPUs one after the other, the records are not ordered by time in
+ * the file. They are processed by time, so that a sample is resolved with the mappings of its
+ * process at the time of the sample. The records without time keep the time of the record preceding
+ * them in the file.
+ *
+ * \param data The data section.
+ * \param size The size of the data section.
+ * \param attr The attributes of the sampled event.
+ * \param ids The identifiers of the sampled event, empty if all the samples are kept.
+ * \param samples The samples to fill.
+ * \param profile The profile, receiving the number of samples.
+ */
+void read_records(const char* data, uint64_t size, const perf_event_attr& attr, const std::vector<uint64_t>& ids, perf_samples& samples, gooda::perf_profile& profile){
+    std::vector<perf_record> records;
+
+    uint64_t time = 0;
+
+    for(uint64_t position = 0; position + sizeof(perf_event_header) <= size;){
+        perf_event_header event;
+        memcpy(&event, data + position, sizeof(event));
+
+        if(event.size < sizeof(event)){
+            throw gooda::gooda_exception("Invalid record in the perf.data file");
+        }
+
+        //The last record is truncated
+        if(event.size > size - position){
+            break;
+        }
+
+        record_time(event, data + position + sizeof(event), event.size - sizeof(event), attr, time);
+
+        records.push_back({time, position});
+
+        position += event.size;
+    }
+
+    std::stable_sort(records.begin(), records.end(), [](const perf_record& lhs, const perf_record& rhs){
+        return lhs.time < rhs.time;
+    });
+
+    for(auto& record : records){
+        perf_event_header event;
+        memcpy(&event, data + record.position, sizeof(event));
+
+        process_record(event, data + record.position + sizeof(event), event.size - sizeof(event), attr.sample_type, ids, samples, profile);
+    }
+}
+
+/*!
+ * \brief Resolve the samples of an ELF file to its functions.
+ * \param executable The ELF file, as recorded by perf.
+ * \param offsets The samples of the ELF file, by offset in the file.
+ * \param config The configuration.
+ * \param profile The profile to fill.
+ */
+void resolve_samples(const std::string& executable, const std::unordered_map<uint64_t, sample_count>& offsets, const gooda::converter_config& config, gooda::perf_profile& profile){
+    uint64_t count = 0;
+    for(auto& offset : offsets){
+        count += offset.second.samples;
+    }
+
+    std::vector<elf_segment> segments;
+    std::vector<elf_function> functions;
+
+    auto file = gooda::executable_path(executable, config.folder);
+
+    if(!read_elf_file(file, segments, functions)){
+        log::emit<log::Warning>() << "Unable to read the ELF file " << file << ", " << count << " samples are ignored" << log::endl;
+
+        profile.unresolved += count;
+        return;
+    }
+
+    //The samples of each function, by address
+    std::map<std::size_t, std::map<uint64_t, uint64_t>> function_samples;
+
+    for(auto& offset : offsets){
+        auto segment = std::find_if(segments.begin(), segments.end(), [&offset](const elf_segment& segment){
+            return offset.first >= segment.offset && offset.first < segment.offset + segment.size;
+        });
+
+        if(segment == segments.end()){
+            profile.unresolved += offset.second.samples;
+            continue;
+        }
+
+        auto address = offset.first - segment->offset + segment->address;
+
+        auto function = std::upper_bound(functions.begin(), functions.end(), address, [](uint64_t address, const elf_function& function){
+            return address < function.address;
+        });
+
+        if(function == functions.begin() || address >= std::prev(function)->address + std::prev(function)->size){
+            profile.unresolved += offset.second.samples;
+            continue;
+        }
+
+        function_samples[std::prev(function) - functions.begin()][address] += offset.second.weight;
+    }
+
+    for(auto& samples : function_samples){
+        auto& function = functions[samples.first];
+
+        gooda::perf_function perf_function;
+        perf_function.name = function.name;
+        perf_function.executable_file = executable;
+        perf_function.address = function.address;
+        perf_function.size = function.size;
+        perf_function.samples.assign(samples.second.begin(), samples.second.end());
+
+        profile.functions.push_back(std::move(perf_function));
+    }
+
+    log::emit<log::Debug>() << "Resolved " << count << " samples of " << file << " to " << function_samples.size() << " functions" << log::endl;
+}
+
+} //end of anonymous namespace
+
+gooda::perf_profile gooda::read_perf_data(const std::string& file, const converter_config& config){
+    log::emit<log::Debug>() << "Import samples from " << file << log::endl;
+
+    mapped_file perf_file(file);
+
+    perf_file_header header;
+    if(perf_file.size < sizeof(header)){
+        throw gooda::gooda_exception("\"" + file + "\" is not a perf.data file in the native byte order");
+    }
+
+    memcpy(&header, perf_file.data, sizeof(header));
+
+    if(header.magic != PERF_MAGIC){
+        throw gooda::gooda_exception("\"" + file + "\" is not a perf.data file in the native byte order");
+    }
+
+    auto attr_size = header.attr_size - sizeof(perf_file_section);
+    if(header.attr_size <= sizeof(perf_file_section) || attr_size < PERF_ATTR_SIZE_VER0 || header.attrs.size < header.attr_size || !perf_file.contains(header.attrs)){
+        throw gooda::gooda_exception("\"" + file + "\" has no valid event attributes");
+    }
+
+    //The sizes of the sections come from the file, they are checked before being used
+    if(!perf_file.contains(header.data)){
+        throw gooda::gooda_exception("\"" + file + "\" is truncated");
+    }
+
+    //Read the attributes and the identifiers of the events
+
+    std::vector<perf_event_attr> attrs;
+    std::vector<std::vector<uint64_t>> ids;
+
+    for(uint64_t position = 0; position + header.attr_size <= header.attrs.size; position += header.attr_size){
+        auto entry = perf_file.data + header.attrs.offset + position;
+
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        memcpy(&attr, entry, std::min<std::size_t>(attr_size, sizeof(attr)));
+
+        perf_file_section section;
+        memcpy(&section, entry + attr_size, sizeof(section));
+
+        if(!perf_file.contains(section)){
+            throw gooda::gooda_exception("\"" + file + "\" has no valid event identifiers");
+        }
+
+        std::vector<uint64_t> event_ids(section.size / sizeof(uint64_t));
+        if(!event_ids.empty()){
+            memcpy(event_ids.data(), perf_file.data + section.offset, event_ids.size() * sizeof(uint64_t));
+        }
+
+        attrs.push_back(attr);
+        ids.push_back(std::move(event_ids));
+    }
+
+    auto event = std::find_if(attrs.begin(), attrs.end(), cycles_event);
+    std::size_t selected = event == attrs.end() ? 0 : event - attrs.begin();
+
+    auto& attr = attrs[selected];
+
+    if(!(attr.sample_type & PERF_SAMPLE_IP) || !(attr.sample_type & PERF_SAMPLE_TID)){
+        throw gooda::gooda_exception("The samples of \"" + file + "\" must have their instruction pointer and their process");
+    }
+
+    //With several events, the samples of the selected one are found by their identifiers
+    if(attrs.size() > 1 && !(attr.sample_type & (PERF_SAMPLE_IDENTIFIER | PERF_SAMPLE_ID))){
+        throw gooda::gooda_exception("The samples of the events of \"" + file + "\" cannot be told apart");
+    }
+
+    log::emit<log::Debug>() << "Select the event " << selected << " of " << attrs.size() << " (type " << attr.type << ", config 0x" << std::hex << attr.config << std::dec << ")" << log::endl;
+
+    perf_samples samples;
+    gooda::perf_profile profile;
+
+    read_records(perf_file.data + header.data.offset, header.data.size, attr, attrs.size() > 1 ? ids[selected] : std::vector<uint64_t>(), samples, profile);
+
+    for(std::size_t i = 0; i < samples.executables.size(); ++i){
+        if(!samples.offsets[i].empty()){
+            resolve_samples(samples.executables[i], samples.offsets[i], config, profile);
+        }
+    }
+
+    log::emit<log::Debug>() << "Found " << profile.samples << " samples in " << profile.functions.size() << " functions ("
+        << profile.unresolved << " unresolved samples)" << log::endl;
+
+    return profile;
+}
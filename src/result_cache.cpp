@@ -0,0 +1,342 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file result_cache.cpp
+ * \brief Implementation of the cache of the generated AFDO profiles.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <set>
+#include <vector>
+#include <iomanip>
+#include <cstdint>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "result_cache.hpp"
+#include "build_id.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+#include "gooda_exception.hpp"
+
+namespace {
+
+/*!
+ * \brief The version of the entries, to change when the generated profiles change.
+ */
+const char* const CACHE_VERSION = "1";
+
+/*!
+ * \brief Compute the MurmurHash64A hash of the given characters.
+ * \param str The characters to hash.
+ * \param size The number of characters.
+ * \param seed The seed of the hash.
+ * \return The hash of the characters.
+ */
+uint64_t murmur_hash(const char* str, std::size_t size, uint64_t seed){
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+
+    uint64_t h = seed ^ (size * m);
+
+    const char* end = str + (size & ~std::size_t(7));
+    for(const char* ptr = str; ptr != end; ptr += 8){
+        uint64_t k;
+        memcpy(&k, ptr, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h ^= k;
+        h *= m;
+    }
+
+    auto tail = reinterpret_cast<const unsigned char*>(end);
+    if(size & 7){
+        for(std::size_t i = size & 7; i > 0; --i){
+            h ^= uint64_t(tail[i - 1]) << (8 * (i - 1));
+        }
+
+        h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+
+    return h;
+}
+
+/*!
+ * \brief Compute a 128 bits hash of the given characters.
+ * \param str The characters to hash.
+ * \return The hash of the characters as an hexadecimal string.
+ */
+std::string content_hash(const std::string& str){
+    char buffer[33];
+    snprintf(buffer, sizeof(buffer), "%016llx%016llx",
+        static_cast<unsigned long long>(murmur_hash(str.data(), str.size(), 0x8445d61a4e774912ULL)),
+        static_cast<unsigned long long>(murmur_hash(str.data(), str.size(), 0x2f9a1c7b3e5d6084ULL)));
+    return buffer;
+}
+
+/*!
+ * \brief Read the whole content of a file.
+ * \param file The path to the file.
+ * \param content The content of the file.
+ * \return true if the file has been read, false otherwise.
+ */
+bool read_content(const std::string& file, std::string& content){
+    std::ifstream stream(file, std::ios::in | std::ios::binary);
+
+    if(!stream.is_open()){
+        return false;
+    }
+
+    std::ostringstream buffer;
+    buffer << stream.rdbuf();
+    content = buffer.str();
+
+    return !stream.bad();
+}
+
+/*!
+ * \brief Add the hashes of all the files of a directory to the key, in a stable order.
+ * \param directory The directory to hash.
+ * \param prefix The path of the directory relative to the hashed root.
+ * \param key The key to complete.
+ */
+void hash_directory(const std::string& directory, const std::string& prefix, std::string& key){
+    auto dir = opendir(directory.c_str());
+    if(!dir){
+        throw gooda::gooda_exception("Unable to list \"" + directory + "\": " + strerror(errno));
+    }
+
+    std::vector<std::string> names;
+    while(auto entry = readdir(dir)){
+        std::string name = entry->d_name;
+
+        if(name != "." && name != ".."){
+            names.push_back(name);
+        }
+    }
+
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+
+    for(auto& name : names){
+        auto path = directory + "/" + name;
+
+        if(gooda::is_directory(path)){
+            hash_directory(path, prefix + name + "/", key);
+        } else {
+            std::string content;
+            if(!read_content(path, content)){
+                throw gooda::gooda_exception("Unable to read \"" + path + "\"");
+            }
+
+            key += prefix + name + '\t' + std::to_string(content.size()) + '\t' + content_hash(content) + '\n';
+        }
+    }
+}
+
+/*!
+ * \brief Return the identity of a binary file: its build-id, or a hash of its content if it has none.
+ * \param file The binary file.
+ * \return The identity of the file, "missing" if it cannot be read.
+ */
+std::string file_identity(const std::string& file){
+    auto id = gooda::build_id(file);
+
+    if(id.empty()){
+        std::string content;
+        id = read_content(file, content) ? "content:" + content_hash(content) : "missing";
+    }
+
+    return id;
+}
+
+/*!
+ * \brief Return the file of a tool, searched in the PATH if its name has no directory, like posix_spawnp.
+ * \param tool The tool, as given in the options.
+ * \return The file of the tool, the tool itself if it is not found.
+ */
+std::string tool_path(const std::string& tool){
+    if(tool.find('/') != std::string::npos){
+        return tool;
+    }
+
+    const char* path = ::getenv("PATH");
+    std::istringstream directories(path ? path : "/bin:/usr/bin");
+
+    std::string directory;
+    while(std::getline(directories, directory, ':')){
+        auto file = (directory.empty() ? std::string(".") : directory) + "/" + tool;
+
+        if(access(file.c_str(), X_OK) == 0){
+            return file;
+        }
+    }
+
+    return tool;
+}
+
+/*!
+ * \brief Compute the hash of the identities of the executables of a profile.
+ *
+ * An executable is identified by its build-id, or by a hash of its content if it has none.
+ *
+ * \param executables The executable files of the profile.
+ * \param config The configuration of the conversion.
+ * \return The hash of the identities of the executables.
+ */
+std::string executables_hash(const std::set<std::string>& executables, const gooda::converter_config& config){
+    std::string identities;
+
+    for(auto& executable : executables){
+        identities += executable + '\t' + file_identity(gooda::executable_path(executable, config.folder)) + '\n';
+    }
+
+    return content_hash(identities);
+}
+
+/*!
+ * \brief Copy a file.
+ * \param source The file to copy.
+ * \param destination The copy.
+ * \return true if the file has been copied, false otherwise.
+ */
+bool copy_file(const std::string& source, const std::string& destination){
+    std::ifstream in(source, std::ios::in | std::ios::binary);
+    std::ofstream out(destination, std::ios::out | std::ios::binary | std::ios::trunc);
+
+    return in.is_open() && out.is_open() && (out << in.rdbuf()) && out.flush();
+}
+
+/*!
+ * \brief Write a file of the cache, in a temporary file renamed to the destination.
+ *
+ * The readers of the cache only see complete files.
+ *
+ * \param destination The file of the cache to write.
+ * \param write The functor writing the temporary file, returning false on failure.
+ * \return true if the file has been written, false otherwise.
+ */
+template<typename Functor>
+bool write_entry(const std::string& destination, Functor write){
+    auto temporary = destination + ".tmp." + std::to_string(getpid());
+
+    if(!write(temporary) || rename(temporary.c_str(), destination.c_str()) == -1){
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+} //end of anonymous namespace
+
+gooda::result_cache::result_cache(const std::string& directory) : directory(directory) {
+    if(mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST){
+        throw gooda::gooda_exception("Unable to create the result cache \"" + directory + "\": " + strerror(errno));
+    }
+}
+
+std::string gooda::result_cache::key(const std::string& spreadsheets, const converter_config& config) const {
+    std::ostringstream options;
+    options << std::setprecision(17) << CACHE_VERSION << '\n'
+        << config.lbr << config.auto_mode << config.working_set << config.cache_misses << config.discriminators << config.filter << '\n'
+        << config.process << '\n'
+        << config.top << '\n'
+        << config.coverage << '\n'
+        << config.folder << '\n'
+        << config.addr2line << '\n'
+        //The output of addr2line differs from one version to the next
+        << file_identity(tool_path(config.addr2line)) << '\n'
+        //The paths of the profile are relative to the current directory
+        << gooda::current_directory() << '\n';
+
+    std::string key = options.str();
+    hash_directory(spreadsheets, "", key);
+
+    return content_hash(key);
+}
+
+bool gooda::result_cache::fetch(const std::string& key, const converter_config& config, const std::string& output) const {
+    std::ifstream manifest(directory + "/" + key + ".executables");
+
+    if(!manifest.is_open()){
+        log::emit<log::Debug>() << "No cached profile for " << key << log::endl;
+        return false;
+    }
+
+    std::set<std::string> executables;
+
+    std::string executable;
+    while(std::getline(manifest, executable)){
+        executables.insert(executable);
+    }
+
+    //A profile is only valid for the same executables
+    auto entry = directory + "/" + key + "-" + executables_hash(executables, config) + ".afdo";
+
+    if(!gooda::exists(entry)){
+        log::emit<log::Debug>() << "No cached profile for " << key << " with the current executables" << log::endl;
+        return false;
+    }
+
+    if(!copy_file(entry, output)){
+        log::emit<log::Warning>() << "Unable to copy the cached profile " << entry << " to " << output << log::endl;
+        return false;
+    }
+
+    log::emit<log::Debug>() << "Copied the cached profile " << entry << " to " << output << log::endl;
+
+    return true;
+}
+
+void gooda::result_cache::store(const std::string& key, const afdo_data& data, const converter_config& config, const std::string& output) const {
+    std::set<std::string> executables;
+    for(auto& function : data.functions){
+        executables.insert(function.executable_file);
+    }
+
+    std::string manifest;
+    for(auto& executable : executables){
+        manifest += executable + '\n';
+    }
+
+    auto manifest_file = directory + "/" + key + ".executables";
+    auto entry = directory + "/" + key + "-" + executables_hash(executables, config) + ".afdo";
+
+    auto stored = write_entry(manifest_file, [&manifest](const std::string& file){
+        std::ofstream stream(file, std::ios::out | std::ios::trunc);
+        return stream.is_open() && (stream << manifest) && stream.flush();
+    });
+
+    stored = stored && write_entry(entry, [&output](const std::string& file){
+        return copy_file(output, file);
+    });
+
+    if(!stored){
+        log::emit<log::Warning>() << "Unable to store " << output << " in the result cache" << log::endl;
+        return;
+    }
+
+    log::emit<log::Debug>() << "Stored " << output << " in the result cache as " << entry << log::endl;
+}
@@ -0,0 +1,358 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file server.cpp
+ * \brief Implementation of the resident conversion server.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include "server.hpp"
+#include "Options.hpp"
+#include "converter.hpp"
+#include "gooda_reader.hpp"
+#include "afdo_generator.hpp"
+#include "daemon_context.hpp"
+#include "parallel.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+#include "gooda_exception.hpp"
+
+namespace {
+
+/*!
+ * \brief The maximum size of a request.
+ */
+const std::size_t MAX_REQUEST = 64 * 1024;
+
+/*!
+ * \brief The time given to a client to send its request, and to read the response, in seconds.
+ */
+const int CONNECTION_TIMEOUT = 10;
+
+/*!
+ * \brief The options that do not convert a single spreadsheets directory to an AFDO file.
+ */
+const char* const UNSUPPORTED_OPTIONS[] = {
+    "read-afdo", "read-perf", "profile", "diff", "afdo-diff", "aggregate", "dump", "full-dump", "serve", "watch", "result-cache",
+    "split-by-process", "split-by-module", "stream", "update-from", "symcache"
+};
+
+/*!
+ * \struct connection_queue
+ * \brief The accepted connections waiting for a worker.
+ */
+struct connection_queue {
+    std::mutex lock;                    //!< Protect the connections
+    std::condition_variable ready;      //!< Signaled when a connection is added or the server stops
+    std::deque<int> connections;        //!< The sockets of the waiting connections
+    bool closed = false;                //!< Indicates that no more connections will be added
+};
+
+/*!
+ * \brief Read a request, up to its end of line.
+ *
+ * The socket has a receive timeout, a client that does not send its request does not hold the worker.
+ *
+ * \param fd The socket of the connection
+ * \return The request, without the end of line
+ */
+std::string read_request(int fd){
+    std::string request;
+    char buffer[4096];
+
+    while(request.size() < MAX_REQUEST){
+        auto count = read(fd, buffer, sizeof(buffer));
+
+        if(count == -1 && errno == EINTR){
+            continue;
+        } else if(count == -1 && errno == EAGAIN){
+            throw gooda::gooda_exception("The request has not been received in " + std::to_string(CONNECTION_TIMEOUT) + " seconds");
+        } else if(count <= 0){
+            throw gooda::gooda_exception("Invalid request");
+        }
+
+        request.append(buffer, count);
+
+        auto end = request.find('\n');
+        if(end != std::string::npos){
+            request.erase(end);
+            return request;
+        }
+    }
+
+    throw gooda::gooda_exception("The request is longer than " + std::to_string(MAX_REQUEST) + " bytes");
+}
+
+/*!
+ * \brief Check that a path of a request is absolute.
+ *
+ * The server does not know the working directory of the client, a relative path would be resolved
+ * against the working directory of the server.
+ *
+ * \param option The option giving the path
+ * \param path The path
+ */
+void check_absolute(const std::string& option, const std::string& path){
+    if(path.empty() || path[0] != '/'){
+        throw gooda::gooda_exception("The " + option + " of a request must be an absolute path, not \"" + path + "\"");
+    }
+}
+
+/*!
+ * \brief Send the response of a request.
+ * \param fd The socket of the connection
+ * \param response The response, without the end of line
+ */
+void send_response(int fd, std::string response){
+    //The response is a single line
+    std::replace(response.begin(), response.end(), '\n', ' ');
+    boost::trim(response);
+    response += '\n';
+
+    std::size_t written = 0;
+    while(written < response.size()){
+        auto count = send(fd, response.data() + written, response.size() - written, MSG_NOSIGNAL);
+
+        if(count == -1 && errno == EINTR){
+            continue;
+        } else if(count <= 0){
+            log::emit<log::Warning>() << "Unable to answer a request: " << strerror(errno) << log::endl;
+            return;
+        }
+
+        written += count;
+    }
+}
+
+/*!
+ * \brief Convert the spreadsheets of a request.
+ * \param request The arguments of the request, separated by tabs
+ * \param context The context of the worker
+ * \return The response to the request
+ */
+std::string convert_request(const std::string& request, gooda::converter_context& context){
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::string> args;
+    boost::split(args, request, [](char c){ return c == '\t'; });
+
+    std::vector<const char*> argv(1, "converter");
+    for(auto& arg : args){
+        argv.push_back(arg.c_str());
+    }
+
+    //The logging level of the server is kept, the --log of the request is ignored
+    gooda::options options;
+    options.parse(argv.size(), argv.data());
+    options.notify();
+
+    auto& vm = options.vm;
+
+    for(auto option : UNSUPPORTED_OPTIONS){
+        if(vm.count(option)){
+            throw gooda::gooda_exception(std::string("--") + option + " is not supported by the server");
+        }
+    }
+
+    if(!vm.count("input-file") || vm["input-file"].as<std::vector<std::string>>().size() != 1){
+        throw gooda::gooda_exception("A request must give exactly one spreadsheets directory");
+    }
+
+    auto directory = vm["input-file"].as<std::vector<std::string>>().front();
+    auto output = vm["output"].as<std::string>();
+
+    check_absolute("spreadsheets directory", directory);
+    check_absolute("output", output);
+
+    if(!vm["folder"].as<std::string>().empty()){
+        check_absolute("folder", vm["folder"].as<std::string>());
+    }
+
+    //A tool without directory is searched in the PATH
+    if(vm["addr2line"].as<std::string>().find('/') != std::string::npos){
+        check_absolute("addr2line", vm["addr2line"].as<std::string>());
+    }
+
+    if(!gooda::is_directory(directory)){
+        throw gooda::gooda_exception("\"" + directory + "\" is not a directory");
+    }
+
+    log::emit<log::Debug>() << "Convert " << directory << " to " << output << log::endl;
+
+    auto config = gooda::make_config(vm);
+
+    auto report = gooda::read_spreadsheets(directory);
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, config, context);
+    gooda::generate_afdo(data, output, config);
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t0);
+
+    return "OK " + std::to_string(context.statistics().functions) + " functions in " + std::to_string(ms.count()) + "ms";
+}
+
+/*!
+ * \brief Answer the connections of the queue until the server stops.
+ * \param queue The queue of connections
+ * \param daemon The daemon context, whose addr2line processes and symbols are shared by the workers
+ */
+void serve_connections(connection_queue& queue, const gooda::daemon_context& daemon){
+    //The addr2line processes of the daemon are kept from one request to the next
+    gooda::converter_context context;
+    daemon.init(context);
+
+    while(true){
+        int fd;
+
+        {
+            std::unique_lock<std::mutex> l(queue.lock);
+            queue.ready.wait(l, [&queue]{ return queue.closed || !queue.connections.empty(); });
+
+            if(queue.connections.empty()){
+                return;
+            }
+
+            fd = queue.connections.front();
+            queue.connections.pop_front();
+        }
+
+        std::string response;
+
+        try {
+            response = convert_request(read_request(fd), context);
+        } catch (const std::exception& e){
+            log::emit<log::Warning>() << "Request failed: " << e.what() << log::endl;
+
+            response = std::string("ERROR ") + e.what();
+        }
+
+        send_response(fd, response);
+
+        close(fd);
+    }
+}
+
+} //end of anonymous namespace
+
+void gooda::serve(const std::string& socket_path, const converter_config& config){
+    gooda::daemon_context daemon(config);
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if(socket_path.size() >= sizeof(address.sun_path)){
+        throw gooda::gooda_exception("The socket path \"" + socket_path + "\" is too long");
+    }
+
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    //The connections are only accepted once poll reports them, the accept must not block
+    auto server = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(server == -1){
+        throw gooda::gooda_exception(std::string("Unable to create the socket: ") + strerror(errno));
+    }
+
+    //A socket left by a previous server is replaced
+    unlink(socket_path.c_str());
+
+    if(bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || listen(server, SOMAXCONN) == -1){
+        auto error = strerror(errno);
+        close(server);
+
+        throw gooda::gooda_exception("Unable to listen on \"" + socket_path + "\": " + error);
+    }
+
+    connection_queue queue;
+
+    auto workers_count = gooda::thread_count(config.jobs);
+
+    //The signals are only delivered to the server thread
+    std::vector<std::thread> workers;
+    for(std::size_t i = 0; i < workers_count; ++i){
+        workers.push_back(daemon.spawn(serve_connections, std::ref(queue), std::cref(daemon)));
+    }
+
+    log::emit<log::Debug>() << "Serve on " << socket_path << " with " << workers_count << " workers" << log::endl;
+
+    //The stop pipe wakes the server, even if the signal arrives before the poll
+    while(!daemon.stopped()){
+        pollfd fds[2];
+        fds[0].fd = server;
+        fds[0].events = POLLIN;
+        fds[1].fd = daemon.stop_fd();
+        fds[1].events = POLLIN;
+
+        if(poll(fds, 2, -1) == -1){
+            if(errno != EINTR){
+                log::emit<log::Warning>() << "Unable to wait for a connection: " << strerror(errno) << log::endl;
+            }
+
+            continue;
+        }
+
+        if(fds[1].revents){
+            break;
+        }
+
+        auto fd = accept4(server, nullptr, nullptr, SOCK_CLOEXEC);
+
+        if(fd == -1){
+            if(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK){
+                log::emit<log::Warning>() << "Unable to accept a connection: " << strerror(errno) << log::endl;
+            }
+
+            continue;
+        }
+
+        //A client that does not send its request, or does not read its response, does not hold a worker
+        timeval timeout;
+        timeout.tv_sec = CONNECTION_TIMEOUT;
+        timeout.tv_usec = 0;
+
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        std::lock_guard<std::mutex> l(queue.lock);
+        queue.connections.push_back(fd);
+        queue.ready.notify_one();
+    }
+
+    log::emit<log::Debug>() << "Stop serving on " << socket_path << log::endl;
+
+    {
+        std::lock_guard<std::mutex> l(queue.lock);
+        queue.closed = true;
+        queue.ready.notify_all();
+    }
+
+    //The pending requests are answered before the server stops
+    for(auto& worker : workers){
+        worker.join();
+    }
+
+    close(server);
+    unlink(socket_path.c_str());
+}
@@ -0,0 +1,227 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file subprocess.cpp
+ * \brief Implementation of the child processes.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "subprocess.hpp"
+#include "logger.hpp"
+#include "gooda_exception.hpp"
+
+extern char** environ;
+
+namespace {
+
+/*!
+ * \brief The size of the chunks read from the output of the process.
+ */
+const std::size_t CHUNK_SIZE = 64 * 1024;
+
+/*!
+ * \brief Throw an exception describing the last system error.
+ * \param message The description of the operation that failed.
+ */
+void system_error(const std::string& message){
+    throw gooda::gooda_exception(message + ": " + strerror(errno));
+}
+
+} //end of anonymous namespace
+
+gooda::subprocess::subprocess(const std::vector<std::string>& args) : pid(-1), input(-1), output(-1), eof(false), consumed(0) {
+    for(auto& arg : args){
+        command += command.empty() ? arg : " " + arg;
+    }
+
+    int in_pipe[2];
+    int out_pipe[2];
+
+    //The standard input is a socket so that it can be written with MSG_NOSIGNAL:
+    //a dead child must result in an error, not in the death of the process embedding the converter
+    if(socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, in_pipe) == -1){
+        system_error("Unable to create pipes for \"" + command + "\"");
+    }
+
+    if(pipe2(out_pipe, O_CLOEXEC) == -1){
+        close(in_pipe[0]);
+        close(in_pipe[1]);
+
+        system_error("Unable to create pipes for \"" + command + "\"");
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, in_pipe[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+
+    std::vector<char*> argv;
+    for(auto& arg : args){
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    log::emit<log::Trace>() << "Run command \"" << command << "\"" << log::endl;
+
+    auto error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+
+    close(in_pipe[0]);
+    close(out_pipe[1]);
+
+    if(error){
+        close(in_pipe[1]);
+        close(out_pipe[0]);
+
+        throw gooda::gooda_exception("Unable to execute \"" + command + "\": " + strerror(error));
+    }
+
+    input = in_pipe[1];
+    output = out_pipe[0];
+
+    //The writes are interleaved with the reads, they must never block
+    fcntl(input, F_SETFL, fcntl(input, F_GETFL) | O_NONBLOCK);
+}
+
+gooda::subprocess::~subprocess(){
+    wait();
+}
+
+void gooda::subprocess::close_input(){
+    if(input != -1){
+        close(input);
+        input = -1;
+    }
+}
+
+int gooda::subprocess::wait(){
+    if(pid == -1){
+        return -1;
+    }
+
+    close_input();
+    close(output);
+    output = -1;
+
+    int status = 0;
+    pid_t result;
+    while((result = waitpid(pid, &status, 0)) == -1 && errno == EINTR){}
+
+    pid = -1;
+
+    //The wait is also done by the destructor, the error is reported without throwing
+    if(result == -1){
+        log::emit<log::Warning>() << "Unable to wait for \"" << command << "\": " << strerror(errno) << log::endl;
+
+        return -1;
+    }
+
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+bool gooda::subprocess::communicate(const std::string& request, const line_handler& handler, bool last){
+    std::size_t written = 0;
+
+    if(request.empty() && last){
+        close_input();
+    }
+
+    std::vector<char> chunk(CHUNK_SIZE);
+
+    while(true){
+        //Consume all the complete lines already read
+
+        std::size_t end;
+        while((end = pending.find('\n', consumed)) != std::string::npos){
+            std::string line(pending, consumed, end - consumed);
+            consumed = end + 1;
+
+            if(!handler(line)){
+                return true;
+            }
+        }
+
+        pending.erase(0, consumed);
+        consumed = 0;
+
+        if(eof){
+            if(!pending.empty()){
+                std::string line;
+                line.swap(pending);
+
+                if(!handler(line)){
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        //Stream the request and read the output at the same time
+
+        pollfd fds[2];
+        fds[0].fd = output;
+        fds[0].events = POLLIN;
+        fds[1].fd = input;
+        fds[1].events = POLLOUT;
+
+        nfds_t nfds = written < request.size() ? 2 : 1;
+
+        if(poll(fds, nfds, -1) == -1){
+            if(errno == EINTR){
+                continue;
+            }
+
+            system_error("Unable to poll \"" + command + "\"");
+        }
+
+        if(nfds == 2 && fds[1].revents){
+            auto count = ::send(input, request.data() + written, request.size() - written, MSG_NOSIGNAL);
+
+            if(count == -1 && errno != EAGAIN && errno != EINTR){
+                system_error("Unable to write to \"" + command + "\"");
+            } else if(count > 0){
+                written += count;
+
+                if(written == request.size() && last){
+                    close_input();
+                }
+            }
+        }
+
+        if(fds[0].revents){
+            auto count = ::read(output, chunk.data(), chunk.size());
+
+            if(count == 0){
+                eof = true;
+            } else if(count == -1 && errno != EINTR){
+                system_error("Unable to read from \"" + command + "\"");
+            } else if(count > 0){
+                pending.append(chunk.data(), count);
+            }
+        }
+    }
+}
+
+int gooda::run_command(const std::vector<std::string>& args, const std::string& input, const std::function<void(std::string&)>& handler){
+    subprocess process(args);
+
+    process.communicate(input, [&handler](std::string& line){ handler(line); return true; }, true);
+
+    return process.wait();
+}
@@ -0,0 +1,369 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file symbol_cache.cpp
+ * \brief Implementation of the persistent cache of the symbolization results.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "symbol_cache.hpp"
+#include "build_id.hpp"
+#include "logger.hpp"
+#include "gooda_exception.hpp"
+
+namespace {
+
+/*!
+ * \brief The maximum number of executables whose build-id is remembered.
+ */
+const std::size_t MAX_EXECUTABLES = 1024;
+
+/*!
+ * \brief Compute the FNV-1a hash of the given characters.
+ * \param str The characters to hash.
+ * \param size The number of characters.
+ * \return The hash of the characters as an hexadecimal string.
+ */
+std::string checksum(const char* str, std::size_t size){
+    unsigned long long hash = 14695981039346656037ULL;
+
+    for(std::size_t i = 0; i < size; ++i){
+        hash ^= static_cast<unsigned char>(str[i]);
+        hash *= 1099511628211ULL;
+    }
+
+    char buffer[17];
+    snprintf(buffer, sizeof(buffer), "%016llx", hash);
+    return buffer;
+}
+
+/*!
+ * \brief Parse an hexadecimal address.
+ * \param address The address to parse, with or without the 0x prefix.
+ * \param value The parsed address.
+ * \return true if the address is valid, false otherwise.
+ */
+bool parse_address(const std::string& address, unsigned long long& value){
+    if(address.empty()){
+        return false;
+    }
+
+    char* end;
+    errno = 0;
+    value = strtoull(address.c_str(), &end, 16);
+
+    return errno == 0 && *end == '\0';
+}
+
+/*!
+ * \brief Indicates if a field can be stored in a record.
+ * \param field The field to test.
+ * \return true if the field does not contain any separator, false otherwise.
+ */
+bool storable(const std::string& field){
+    return field.find_first_of("\t\n") == std::string::npos;
+}
+
+/*!
+ * \brief Complete the record and add it to the records.
+ * \param records The records to complete.
+ * \param record The record to add.
+ */
+void add_record(std::string& records, std::string& record){
+    auto sum = checksum(record.data(), record.size());
+
+    records += record;
+    records += '\t';
+    records += sum;
+    records += '\n';
+}
+
+} //end of anonymous namespace
+
+gooda::symbol_cache::symbol_cache(const std::string& directory, std::size_t capacity) : directory(directory), capacity(std::max<std::size_t>(capacity, 1)) {
+    if(!directory.empty() && mkdir(directory.c_str(), 0755) == -1 && errno != EEXIST){
+        throw gooda::gooda_exception("Unable to create the symbol cache \"" + directory + "\": " + strerror(errno));
+    }
+}
+
+std::string gooda::symbol_cache::build_id(const std::string& executable){
+    struct stat st;
+    if(stat(executable.c_str(), &st) == -1){
+        return "";
+    }
+
+    {
+        std::lock_guard<std::mutex> l(lock);
+
+        auto it = build_ids.find(executable);
+        if(it != build_ids.end() && it->second.first == st.st_mtime){
+            return it->second.second;
+        }
+    }
+
+    auto id = gooda::build_id(executable);
+
+    if(id.empty()){
+        log::emit<log::Debug>() << executable << " has no build-id, its symbols are not cached" << log::endl;
+    }
+
+    std::lock_guard<std::mutex> l(lock);
+
+    //The executables seen by a long-lived cache are forgotten from time to time, their build-id is read again
+    if(build_ids.size() >= MAX_EXECUTABLES){
+        build_ids.clear();
+    }
+
+    build_ids[executable] = {st.st_mtime, id};
+
+    return id;
+}
+
+gooda::symbol_cache::cached_binary& gooda::symbol_cache::binary(const std::string& id){
+    auto it = binaries.find(id);
+    if(it != binaries.end()){
+        it->second.last_use = ++clock;
+        return it->second;
+    }
+
+    //The build-id used the least recently is released
+    if(binaries.size() >= capacity){
+        auto oldest = binaries.begin();
+        for(auto it = binaries.begin(); it != binaries.end(); ++it){
+            if(it->second.last_use < oldest->second.last_use){
+                oldest = it;
+            }
+        }
+
+        log::emit<log::Debug>() << "Release the cached symbols of " << oldest->first << log::endl;
+
+        binaries.erase(oldest);
+    }
+
+    auto& binary = binaries[id];
+    binary.last_use = ++clock;
+
+    if(directory.empty()){
+        return binary;
+    }
+
+    std::ifstream stream(directory + "/" + id);
+    if(!stream){
+        return binary;
+    }
+
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    auto content = buffer.str();
+
+    std::size_t records = 0;
+    std::size_t invalid = 0;
+
+    std::size_t start = 0;
+    std::size_t end;
+
+    //A last line without end of line is a record still being written
+    while((end = content.find('\n', start)) != std::string::npos){
+        auto line_start = start;
+        start = end + 1;
+
+        //The writers terminate the torn records, which can leave empty lines
+        if(end == line_start){
+            continue;
+        }
+
+        auto sum = content.rfind('\t', end);
+        if(sum == std::string::npos || sum < line_start || content.compare(sum + 1, end - sum - 1, checksum(&content[line_start], sum - line_start)) != 0){
+            ++invalid;
+            continue;
+        }
+
+        std::vector<std::string> fields;
+        std::size_t field_start = line_start;
+        std::size_t field_end;
+        while((field_end = content.find('\t', field_start)) < sum){
+            fields.emplace_back(content, field_start, field_end - field_start);
+            field_start = field_end + 1;
+        }
+        fields.emplace_back(content, field_start, sum - field_start);
+
+        unsigned long long address;
+        if(fields.size() < 2 || !parse_address(fields[1], address)){
+            ++invalid;
+            continue;
+        }
+
+        if(fields[0] == "F" && fields.size() == 3){
+            binary.names[address] = fields[2];
+        } else if(fields[0] == "A" && fields.size() >= 3){
+            auto count = strtoull(fields[2].c_str(), nullptr, 10);
+
+            if(fields.size() != 3 + 2 * count){
+                ++invalid;
+                continue;
+            }
+
+            std::vector<addr2line_frame> frames(count);
+            for(std::size_t i = 0; i < count; ++i){
+                frames[i].function = std::move(fields[3 + 2 * i]);
+                frames[i].location = std::move(fields[4 + 2 * i]);
+            }
+
+            binary.frames[address] = std::move(frames);
+        } else {
+            ++invalid;
+            continue;
+        }
+
+        ++records;
+    }
+
+    log::emit<log::Debug>() << "Load " << records << " cached symbols of " << id << " (" << invalid << " invalid records)" << log::endl;
+
+    return binary;
+}
+
+void gooda::symbol_cache::lookup_frames(const std::string& id, address_iterator first, address_iterator last, std::vector<symbol_frames>& hits, std::vector<std::string>& misses){
+    std::lock_guard<std::mutex> l(lock);
+
+    auto& frames = binary(id).frames;
+
+    for(auto it = first; it != last; ++it){
+        unsigned long long address;
+        std::unordered_map<unsigned long long, std::vector<addr2line_frame>>::const_iterator entry;
+
+        if(parse_address(*it, address) && (entry = frames.find(address)) != frames.end()){
+            hits.emplace_back(*it, entry->second);
+        } else {
+            misses.push_back(*it);
+        }
+    }
+}
+
+bool gooda::symbol_cache::lookup_names(const std::string& id, const std::vector<std::string>& addresses, std::vector<symbol_name>& names){
+    std::lock_guard<std::mutex> l(lock);
+
+    auto& cached = binary(id).names;
+
+    for(auto& str : addresses){
+        unsigned long long address;
+        std::unordered_map<unsigned long long, std::string>::const_iterator entry;
+
+        if(!parse_address(str, address) || (entry = cached.find(address)) == cached.end()){
+            names.clear();
+            return false;
+        }
+
+        names.emplace_back(str, entry->second);
+    }
+
+    return true;
+}
+
+void gooda::symbol_cache::store_frames(const std::string& id, const std::vector<symbol_frames>& entries){
+    std::string records;
+    std::string record;
+
+    std::lock_guard<std::mutex> l(lock);
+
+    auto& frames = binary(id).frames;
+
+    for(auto& entry : entries){
+        //The duplicate addresses are only stored once
+        unsigned long long address;
+        if(!parse_address(entry.first, address) || frames.count(address)){
+            continue;
+        }
+
+        std::stringstream stream;
+        stream << "A\t0x" << std::hex << address << std::dec << "\t" << entry.second.size();
+
+        bool valid = true;
+        for(auto& frame : entry.second){
+            valid = valid && storable(frame.function) && storable(frame.location);
+            stream << "\t" << frame.function << "\t" << frame.location;
+        }
+
+        if(valid){
+            record = stream.str();
+            add_record(records, record);
+
+            frames[address] = entry.second;
+        }
+    }
+
+    append(id, records);
+}
+
+void gooda::symbol_cache::store_names(const std::string& id, const std::vector<symbol_name>& entries){
+    std::string records;
+    std::string record;
+
+    std::lock_guard<std::mutex> l(lock);
+
+    auto& names = binary(id).names;
+
+    for(auto& entry : entries){
+        unsigned long long address;
+        if(!parse_address(entry.first, address) || !storable(entry.second) || names.count(address)){
+            continue;
+        }
+
+        std::stringstream stream;
+        stream << "F\t0x" << std::hex << address << std::dec << "\t" << entry.second;
+
+        record = stream.str();
+        add_record(records, record);
+
+        names[address] = entry.second;
+    }
+
+    append(id, records);
+}
+
+void gooda::symbol_cache::append(const std::string& id, const std::string& records){
+    if(records.empty() || directory.empty()){
+        return;
+    }
+
+    auto file = directory + "/" + id;
+
+    //A single write in append mode is never interleaved with the writes of the other converters
+    auto fd = open(file.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if(fd == -1){
+        log::emit<log::Warning>() << "Unable to open the symbol cache \"" << file << "\": " << strerror(errno) << log::endl;
+        return;
+    }
+
+    //A record torn by a previous writer must not swallow the first new record
+    std::string data;
+    char last;
+    struct stat st;
+    if(fstat(fd, &st) == 0 && st.st_size > 0 && pread(fd, &last, 1, st.st_size - 1) == 1 && last != '\n'){
+        data += '\n';
+    }
+
+    data += records;
+
+    auto count = write(fd, data.data(), data.size());
+    if(count != static_cast<ssize_t>(data.size())){
+        log::emit<log::Warning>() << "Unable to write to the symbol cache \"" << file << "\"" << log::endl;
+    }
+
+    close(fd);
+}
@@ -13,13 +13,19 @@
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <cctype>
+#include <set>
 
+#include <climits>
+
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
 #include "utils.hpp"
+#include "logger.hpp"
 #include "gooda_exception.hpp"
 
 bool gooda::exists(const std::string& file){
@@ -35,29 +41,74 @@ bool gooda::is_directory(const std::string& file){
     return S_ISDIR(st.st_mode);
 }
 
-int gooda::exec_command(const std::string& command) {
-    return system(command.c_str());
+bool gooda::same_file(const std::string& first, const std::string& second){
+    struct stat first_st;
+    struct stat second_st;
+
+    return stat(first.c_str(), &first_st) != -1 && stat(second.c_str(), &second_st) != -1
+        && first_st.st_dev == second_st.st_dev && first_st.st_ino == second_st.st_ino;
+}
+
+std::string gooda::current_directory(){
+    char buffer[PATH_MAX];
+    if(!getcwd(buffer, sizeof(buffer))){
+        throw gooda::gooda_exception("Unable to get the current directory");
+    }
+
+    return buffer;
 }
 
-std::string gooda::exec_command_result(const std::string& command){
-    FILE* stream = popen(command.c_str(), "r");
+std::string gooda::partition_output(const std::string& output, const std::string& partition){
+    std::string name = partition.empty() ? "unknown" : partition;
+    for(auto& c : name){
+        if(!std::isalnum(static_cast<unsigned char>(c)) && c != '.' && c != '-' && c != '_'){
+            c = '_';
+        }
+    }
+
+    auto slash = output.rfind('/');
+    auto dot = output.rfind('.');
 
-    if(!stream){
-        throw gooda::gooda_exception("Unable to execute \"" + command + "\": Null pipe");
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash)){
+        return output + "." + name;
     }
-    
-    std::string result;
-    char buffer[1024];
 
-    while(!feof(stream)) {
-        if(fgets(buffer, 1024, stream) != NULL){
-            result += buffer;
+    return output.substr(0, dot) + "." + name + output.substr(dot);
+}
+
+std::vector<std::string> gooda::partition_outputs(const std::string& output, const std::vector<std::string>& partitions){
+    std::vector<std::string> files;
+    std::set<std::string> used;
+
+    for(auto& partition : partitions){
+        auto file = partition_output(output, partition);
+
+        auto unique = file;
+        for(std::size_t i = 2; used.count(unique); ++i){
+            unique = partition_output(output, (partition.empty() ? "unknown" : partition) + "-" + std::to_string(i));
+        }
+
+        if(unique != file){
+            log::emit<log::Warning>() << "The profile of \"" << partition << "\" is written to " << unique << " because " << file << " is already used" << log::endl;
         }
+
+        used.insert(unique);
+        files.push_back(unique);
     }
 
-    pclose(stream);
-    
-    return result;
+    return files;
+}
+
+std::string gooda::executable_path(const std::string& executable_file, const std::string& folder){
+    if(folder.empty()){
+        return executable_file;
+    }
+
+    return folder + "/" + executable_file;
+}
+
+int gooda::exec_command(const std::string& command) {
+    return system(command.c_str());
 }
 
 int gooda::processor_model(){
@@ -0,0 +1,487 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file watcher.cpp
+ * \brief Implementation of the conversion of the spreadsheets as they are written in a directory.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+#include "watcher.hpp"
+#include "converter.hpp"
+#include "gooda_reader.hpp"
+#include "afdo_generator.hpp"
+#include "daemon_context.hpp"
+#include "utils.hpp"
+#include "logger.hpp"
+#include "gooda_exception.hpp"
+
+namespace {
+
+/*!
+ * \brief The events of the watched directory, signaling a new spreadsheets directory.
+ */
+const uint32_t DIRECTORY_EVENTS = IN_CREATE | IN_MOVED_TO | IN_ONLYDIR;
+
+/*!
+ * \brief The events of a spreadsheets directory and of its assembly folder, signaling a new or a complete file.
+ */
+const uint32_t SPREADSHEETS_EVENTS = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR;
+
+/*!
+ * \brief The time without event after which an indexed spreadsheets directory is converted without its missing assembly views.
+ */
+const std::chrono::seconds QUIET_PERIOD(10);
+
+typedef std::chrono::steady_clock watch_clock;
+
+/*!
+ * \struct spreadsheets_state
+ * \brief The progress of the writing of a spreadsheets directory.
+ */
+struct spreadsheets_state {
+    std::string directory;              //!< The spreadsheets directory
+    int watch = -1;                     //!< The watch of the spreadsheets directory
+    int asm_watch = -1;                 //!< The watch of the assembly folder, -1 if not watched yet
+    bool indexed = false;               //!< Indicates that the process and hotspot views are complete
+    std::size_t functions = 0;          //!< The number of hotspot functions, once indexed
+    std::size_t next = 0;               //!< The first assembly view not known to be complete
+    watch_clock::time_point last_event; //!< The time of the last event of the spreadsheets directory
+};
+
+/*!
+ * \class spreadsheets_watcher
+ * \brief Follow the spreadsheets directories of the watched directory and convert them once complete.
+ */
+class spreadsheets_watcher {
+    public:
+        /*!
+         * \brief Create a watcher of the given directory.
+         * \param directory The directory to watch.
+         * \param output The output file, used to name the profiles.
+         * \param config The configuration of the conversions.
+         * \param daemon The daemon context of the watch.
+         */
+        spreadsheets_watcher(const std::string& directory, const std::string& output, const gooda::converter_config& config, const gooda::daemon_context& daemon);
+
+        /*!
+         * \brief Close the inotify instance.
+         */
+        ~spreadsheets_watcher();
+
+        /*!
+         * \brief Convert the spreadsheets directories until the watch is stopped.
+         */
+        void run();
+
+    private:
+        /*!
+         * \brief Follow the spreadsheets directories of the watched directory that have no profile yet.
+         */
+        void scan();
+
+        /*!
+         * \brief Follow a new spreadsheets directory.
+         * \param name The name of the spreadsheets directory in the watched directory.
+         */
+        void add(const std::string& name);
+
+        /*!
+         * \brief Stop following a spreadsheets directory.
+         * \param name The name of the spreadsheets directory in the watched directory.
+         */
+        void remove(const std::string& name);
+
+        /*!
+         * \brief Check if a spreadsheets directory is complete and convert it if it is.
+         *
+         * Once its hotspot view is complete, a spreadsheets directory without event during the quiet period is
+         * complete, its missing assembly views are skipped.
+         *
+         * \param name The name of the spreadsheets directory in the watched directory.
+         */
+        void update(const std::string& name);
+
+        /*!
+         * \brief Check the spreadsheets directories whose quiet period is over.
+         */
+        void expire();
+
+        /*!
+         * \brief Return the time to wait for an event before the next quiet period is over.
+         * \return The timeout in milliseconds, -1 if no spreadsheets directory waits for its quiet period.
+         */
+        int timeout() const;
+
+        /*!
+         * \brief Convert a complete spreadsheets directory.
+         * \param name The name of the spreadsheets directory in the watched directory.
+         * \param spreadsheets The path to the spreadsheets directory.
+         */
+        void convert(const std::string& name, const std::string& spreadsheets);
+
+        /*!
+         * \brief Handle an inotify event.
+         * \param event The event to handle.
+         */
+        void handle(const inotify_event& event);
+
+        /*!
+         * \brief Watch a directory.
+         * \param path The directory to watch.
+         * \param events The events to watch.
+         * \return The watch descriptor, -1 if the directory cannot be watched.
+         */
+        int add_watch(const std::string& path, uint32_t events);
+
+        const std::string directory;                            //!< The watched directory
+        const std::string output;                               //!< The output file, used to name the profiles
+        const gooda::converter_config& config;                  //!< The configuration of the conversions
+        const gooda::daemon_context& daemon;                    //!< The daemon context of the watch
+
+        int fd;                                                 //!< The inotify instance
+        int root_watch;                                         //!< The watch of the watched directory
+
+        //The context keeps its addr2line processes from one conversion to the next
+        gooda::converter_context context;
+
+        std::map<std::string, spreadsheets_state> pending;      //!< The incomplete spreadsheets directories, by name
+        std::map<std::string, std::string> converted;           //!< The spreadsheets directory converted to each profile
+        std::unordered_map<int, std::string> watches;           //!< The name of the spreadsheets directory of each watch
+};
+
+spreadsheets_watcher::spreadsheets_watcher(const std::string& directory, const std::string& output, const gooda::converter_config& config, const gooda::daemon_context& daemon) :
+        directory(directory), output(output), config(config), daemon(daemon) {
+    fd = inotify_init1(IN_CLOEXEC);
+    if(fd == -1){
+        throw gooda::gooda_exception(std::string("Unable to initialize inotify: ") + strerror(errno));
+    }
+
+    root_watch = inotify_add_watch(fd, directory.c_str(), DIRECTORY_EVENTS);
+    if(root_watch == -1){
+        auto error = strerror(errno);
+        close(fd);
+
+        throw gooda::gooda_exception("Unable to watch \"" + directory + "\": " + error);
+    }
+
+    daemon.init(context);
+}
+
+spreadsheets_watcher::~spreadsheets_watcher(){
+    close(fd);
+}
+
+int spreadsheets_watcher::add_watch(const std::string& path, uint32_t events){
+    auto watch = inotify_add_watch(fd, path.c_str(), events);
+
+    if(watch == -1 && errno != ENOENT && errno != ENOTDIR){
+        log::emit<log::Warning>() << "Unable to watch \"" << path << "\": " << strerror(errno) << log::endl;
+    }
+
+    return watch;
+}
+
+void spreadsheets_watcher::scan(){
+    auto dir = opendir(directory.c_str());
+    if(!dir){
+        throw gooda::gooda_exception("Unable to list \"" + directory + "\": " + strerror(errno));
+    }
+
+    while(auto entry = readdir(dir)){
+        std::string name = entry->d_name;
+
+        if(name == "." || name == ".." || pending.count(name) || !gooda::is_directory(directory + "/" + name)){
+            continue;
+        }
+
+        //The spreadsheets directories converted before are not converted again
+        if(!gooda::exists(gooda::partition_output(output, name))){
+            add(name);
+        }
+    }
+
+    closedir(dir);
+}
+
+void spreadsheets_watcher::add(const std::string& name){
+    spreadsheets_state state;
+    state.directory = directory + "/" + name;
+    state.last_event = watch_clock::now();
+    state.watch = add_watch(state.directory, SPREADSHEETS_EVENTS);
+
+    if(state.watch == -1){
+        return;
+    }
+
+    state.asm_watch = add_watch(state.directory + "/asm", SPREADSHEETS_EVENTS);
+
+    watches[state.watch] = name;
+    if(state.asm_watch != -1){
+        watches[state.asm_watch] = name;
+    }
+
+    pending[name] = state;
+
+    log::emit<log::Debug>() << "Watch " << state.directory << log::endl;
+
+    //The files written before the watches were added have no event
+    update(name);
+}
+
+void spreadsheets_watcher::remove(const std::string& name){
+    auto it = pending.find(name);
+    if(it == pending.end()){
+        return;
+    }
+
+    for(auto watch : {it->second.watch, it->second.asm_watch}){
+        if(watch != -1){
+            inotify_rm_watch(fd, watch);
+            watches.erase(watch);
+        }
+    }
+
+    pending.erase(it);
+}
+
+void spreadsheets_watcher::update(const std::string& name){
+    auto& state = pending[name];
+
+    try {
+        if(!state.indexed){
+            if(!gooda::spreadsheet_index_complete(state.directory)){
+                return;
+            }
+
+            state.functions = gooda::read_spreadsheet_index(state.directory).functions();
+            state.indexed = true;
+        }
+
+        //The assembly views are written one after the other, the complete ones are not checked again
+        while(state.next < state.functions && gooda::asm_view_complete(state.directory, state.next)){
+            ++state.next;
+        }
+
+        if(state.next < state.functions){
+            if(watch_clock::now() - state.last_event < QUIET_PERIOD){
+                return;
+            }
+
+            log::emit<log::Debug>() << "No event in " << state.directory << " for " << QUIET_PERIOD.count() << "s, convert it without its missing assembly views" << log::endl;
+        }
+
+        convert(name, state.directory);
+    } catch (const gooda::gooda_exception& e){
+        log::emit<log::Warning>() << "Unable to convert " << state.directory << ": " << e.what() << log::endl;
+    }
+
+    remove(name);
+}
+
+void spreadsheets_watcher::convert(const std::string& name, const std::string& spreadsheets){
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    auto file = gooda::partition_output(output, name);
+
+    //Two names can have the same safe form, the profile of the first one is kept
+    auto it = converted.find(file);
+    if(it != converted.end() && it->second != name){
+        throw gooda::gooda_exception(file + " is already the profile of " + it->second);
+    }
+
+    converted[file] = name;
+
+    auto report = gooda::read_spreadsheets(spreadsheets);
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, config, context);
+    gooda::generate_afdo(data, file, config);
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - t0);
+
+    log::emit<log::Debug>() << "Converted " << spreadsheets << " to " << file << " (" << context.statistics().functions << " functions) in " << ms.count() << "ms" << log::endl;
+}
+
+void spreadsheets_watcher::handle(const inotify_event& event){
+    //Some events were lost, the state of the directories is read again
+    if(event.mask & IN_Q_OVERFLOW){
+        std::vector<std::string> names;
+        for(auto& state : pending){
+            names.push_back(state.first);
+        }
+
+        for(auto& name : names){
+            update(name);
+        }
+
+        scan();
+
+        return;
+    }
+
+    if(event.wd == root_watch){
+        if(event.mask & IN_IGNORED){
+            throw gooda::gooda_exception("\"" + directory + "\" is no longer watched");
+        }
+
+        if((event.mask & IN_ISDIR) && event.len > 0 && !pending.count(event.name)){
+            add(event.name);
+        }
+
+        return;
+    }
+
+    auto it = watches.find(event.wd);
+    if(it == watches.end()){
+        return;
+    }
+
+    auto name = it->second;
+    auto& state = pending[name];
+
+    state.last_event = watch_clock::now();
+
+    //The spreadsheets directory has been removed or moved away
+    if(event.mask & IN_IGNORED){
+        watches.erase(it);
+
+        if(event.wd == state.watch){
+            state.watch = -1;
+            remove(name);
+        } else {
+            state.asm_watch = -1;
+        }
+
+        return;
+    }
+
+    if(event.wd == state.watch && (event.mask & IN_ISDIR) && event.len > 0 && strcmp(event.name, "asm") == 0 && state.asm_watch == -1){
+        state.asm_watch = add_watch(state.directory + "/asm", SPREADSHEETS_EVENTS);
+
+        if(state.asm_watch != -1){
+            watches[state.asm_watch] = name;
+        }
+    }
+
+    update(name);
+}
+
+void spreadsheets_watcher::expire(){
+    auto now = watch_clock::now();
+
+    std::vector<std::string> names;
+    for(auto& state : pending){
+        if(state.second.indexed && now - state.second.last_event >= QUIET_PERIOD){
+            names.push_back(state.first);
+        }
+    }
+
+    for(auto& name : names){
+        update(name);
+    }
+}
+
+int spreadsheets_watcher::timeout() const {
+    auto now = watch_clock::now();
+    int timeout = -1;
+
+    //The directories whose hotspot view is incomplete wait for their events
+    for(auto& state : pending){
+        if(state.second.indexed){
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(state.second.last_event + QUIET_PERIOD - now).count();
+            auto ms = static_cast<int>(std::max<decltype(remaining)>(remaining, 0));
+
+            timeout = timeout == -1 ? ms : std::min(timeout, ms);
+        }
+    }
+
+    return timeout;
+}
+
+void spreadsheets_watcher::run(){
+    scan();
+
+    //Large enough for several events with their names
+    alignas(inotify_event) char buffer[64 * 1024];
+
+    //The stop pipe wakes the watch, even if the signal arrives before the poll
+    while(!daemon.stopped()){
+        pollfd fds[2];
+        fds[0].fd = fd;
+        fds[0].events = POLLIN;
+        fds[1].fd = daemon.stop_fd();
+        fds[1].events = POLLIN;
+
+        auto ready = poll(fds, 2, timeout());
+
+        if(ready == -1){
+            if(errno == EINTR){
+                continue;
+            }
+
+            throw gooda::gooda_exception(std::string("Unable to wait for the inotify events: ") + strerror(errno));
+        }
+
+        if(fds[1].revents){
+            break;
+        }
+
+        if(!(fds[0].revents & POLLIN)){
+            expire();
+            continue;
+        }
+
+        auto count = read(fd, buffer, sizeof(buffer));
+
+        if(count == -1){
+            if(errno == EINTR){
+                continue;
+            }
+
+            throw gooda::gooda_exception(std::string("Unable to read the inotify events: ") + strerror(errno));
+        }
+
+        for(char* ptr = buffer; ptr < buffer + count;){
+            auto& event = *reinterpret_cast<inotify_event*>(ptr);
+
+            handle(event);
+
+            ptr += sizeof(inotify_event) + event.len;
+        }
+    }
+}
+
+} //end of anonymous namespace
+
+void gooda::watch(const std::string& directory, const std::string& output, const converter_config& config){
+    if(!gooda::is_directory(directory)){
+        throw gooda::gooda_exception("\"" + directory + "\" is not a directory");
+    }
+
+    gooda::daemon_context daemon(config);
+
+    spreadsheets_watcher watcher(directory, output, config, daemon);
+
+    log::emit<log::Debug>() << "Watch " << directory << " for new spreadsheets" << log::endl;
+
+    watcher.run();
+
+    log::emit<log::Debug>() << "Stop watching " << directory << log::endl;
+}
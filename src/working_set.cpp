@@ -0,0 +1,156 @@
+//=======================================================================
+// Copyright Baptiste Wicht 2012-2013.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at
+// http://www.boost.org/LICENSE_1_0.txt)
+//=======================================================================
+
+/*!
+ * \file working_set.cpp
+ * \brief Implementation of the computation of the working set.
+ */
+
+#include <algorithm>
+#include <functional>
+
+#include "working_set.hpp"
+#include "parallel.hpp"
+#include "flat_hash_map.hpp"
+#include "logger.hpp"
+
+namespace {
+
+/*!
+ * \brief Fill the buckets of the working set from the runs of instructions sharing the same count.
+ * \param data The AFDO profile whose working set is filled.
+ * \param total_count The sum of the counts.
+ * \param next_run Functor giving the next run (count and number of instructions), by decreasing count. It returns false after the last run.
+ * \tparam Runs The type of the functor.
+ */
+template<typename Runs>
+void fill_working_set(gooda::afdo_data& data, uint64_t total_count, Runs next_run){
+    //Fill the working set with zero
+    for(auto& working_set : data.working_set){
+        working_set.num_counter = 0;
+        working_set.min_counter = 0;
+    }
+
+    unsigned int bucket_num = 0;
+    uint64_t accumulated_count = 0;
+    uint64_t accumulated_inst = 0;
+    uint64_t one_bucket_count = total_count / (gooda::WS_SIZE + 1);
+
+    uint64_t count;
+    uint64_t num_inst;
+
+    while(bucket_num < gooda::WS_SIZE && next_run(count, num_inst)){
+        while(count * num_inst + accumulated_count > one_bucket_count * (bucket_num + 1)){
+            int offset = (one_bucket_count * (bucket_num + 1) - accumulated_count) / count;
+
+            accumulated_inst += offset;
+            accumulated_count += offset * count;
+
+            num_inst -= offset;
+
+            if(bucket_num >= gooda::WS_SIZE){
+                break;
+            }
+
+            data.working_set.at(bucket_num).num_counter = accumulated_inst;
+            data.working_set.at(bucket_num).min_counter = count;
+            ++bucket_num;
+        }
+
+        accumulated_inst += num_inst;
+        accumulated_count += num_inst * count;
+    }
+}
+
+} //end of anonymous namespace
+
+void gooda::compute_working_set(std::vector<uint64_t>& counts, uint64_t total_count, afdo_data& data, std::size_t jobs){
+    gooda::parallel_sort(counts.begin(), counts.end(), std::greater<uint64_t>(), jobs);
+
+    std::size_t i = 0;
+
+    fill_working_set(data, total_count, [&counts, &i](uint64_t& count, uint64_t& num_inst){
+        if(i == counts.size()){
+            return false;
+        }
+
+        //The instructions with the same count are consumed together
+        count = counts[i];
+
+        auto next = i + 1;
+        while(next < counts.size() && counts[next] == count){
+            ++next;
+        }
+
+        num_inst = next - i;
+        i = next;
+
+        return true;
+    });
+}
+
+void gooda::compute_working_set(std::vector<std::pair<uint64_t, uint64_t>>& histogram, uint64_t total_count, afdo_data& data){
+    std::sort(histogram.begin(), histogram.end(), std::greater<std::pair<uint64_t, uint64_t>>());
+
+    std::size_t i = 0;
+
+    fill_working_set(data, total_count, [&histogram, &i](uint64_t& count, uint64_t& num_inst){
+        if(i == histogram.size()){
+            return false;
+        }
+
+        count = histogram[i].first;
+        num_inst = histogram[i].second;
+        ++i;
+
+        return true;
+    });
+}
+
+void gooda::collect_stack_counts(const afdo_data& data, bool lbr, std::vector<std::pair<uint64_t, uint64_t>>& histogram, uint64_t& total_count){
+    //The number of instructions of a stack is read from the profile, the instructions are never expanded
+    gooda::flat_hash_map<uint64_t, uint64_t> runs;
+
+    for(auto& function : data.functions){
+        for(auto& stack : function.stacks){
+            //A stack without instructions still holds its count
+            uint64_t num_inst = stack.num_inst > 0 ? stack.num_inst : 1;
+            uint64_t count = stack.count > 0 ? stack.count : 0;
+
+            if(lbr){
+                runs[count] += num_inst;
+                total_count += count * num_inst;
+            } else {
+                //The remainder goes to the first instructions, so that the total is the count of the stack
+                auto remainder = count % num_inst;
+
+                runs[count / num_inst] += num_inst - remainder;
+
+                if(remainder > 0){
+                    runs[count / num_inst + 1] += remainder;
+                }
+
+                total_count += count;
+            }
+        }
+    }
+
+    runs.for_each([&histogram](uint64_t count, uint64_t num_inst){
+        histogram.emplace_back(count, num_inst);
+    });
+}
+
+void gooda::recompute_working_set(afdo_data& data, bool lbr){
+    std::vector<std::pair<uint64_t, uint64_t>> histogram;
+    uint64_t total_count = 0;
+
+    collect_stack_counts(data, lbr, histogram, total_count);
+
+    log::emit<log::Debug>() << "Recompute the working set from " << histogram.size() << " distinct counts" << log::endl;
+
+    compute_working_set(histogram, total_count, data);
+}
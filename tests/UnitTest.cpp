@@ -6,16 +6,44 @@
 //=======================================================================
 
 #include <string>
+#include <algorithm>
 #include <iostream>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <chrono>
+#include <csignal>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE ConverterTestSuites
+#include <linux/perf_event.h>
+
 #include <boost/test/unit_test.hpp>
 #include <boost/test/unit_test_parameters.hpp>
 
 #include "Options.hpp"
 #include "gooda_reader.hpp"
 #include "converter.hpp"
+#include "afdo_generator.hpp"
+#include "afdo_reader.hpp"
+#include "perf_reader.hpp"
+#include "flat_hash_map.hpp"
+#include "build_id.hpp"
+#include "symbol_cache.hpp"
+#include "addr2line.hpp"
+#include "result_cache.hpp"
+#include "server.hpp"
+#include "watcher.hpp"
+#include "utils.hpp"
+#include "working_set.hpp"
+#include "gooda_exception.hpp"
 
 inline void parse_options(gooda::options& options, std::string param1, std::string folder){
     std::string folder_arg = "--folder=" + folder;
@@ -32,6 +60,43 @@ inline void parse_options(gooda::options& options, std::string param1, std::stri
     options.notify();
 }
 
+/*!
+ * \brief Create a new temporary directory, removed at the end of the scope.
+ */
+struct temporary_directory {
+    std::string path;
+
+    temporary_directory(){
+        char name[] = "/tmp/converter_test.XXXXXX";
+        BOOST_REQUIRE(mkdtemp(name));
+        path = name;
+    }
+
+    ~temporary_directory(){
+        gooda::exec_command("rm -rf " + path);
+    }
+};
+
+/*!
+ * \brief Return the configuration of the conversions of the deep case.
+ */
+gooda::converter_config deep_config(){
+    gooda::converter_config config;
+    config.auto_mode = true;
+    config.folder = "tests/cases/deep/";
+    return config;
+}
+
+/*!
+ * \brief Return the content of a file.
+ */
+std::string file_content(const std::string& file){
+    std::ifstream stream(file, std::ios::in | std::ios::binary);
+    std::stringstream buffer;
+    buffer << stream.rdbuf();
+    return buffer.str();
+}
+
 BOOST_AUTO_TEST_SUITE(MainSuite)
 
 struct P {
@@ -91,7 +156,7 @@ BOOST_AUTO_TEST_CASE( simple_ucc ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 1);
     BOOST_CHECK_EQUAL (report.processes(), 7);
@@ -128,7 +193,7 @@ BOOST_AUTO_TEST_CASE( simple_lbr ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 1);
     BOOST_CHECK_EQUAL (report.processes(), 6);
@@ -170,7 +235,7 @@ BOOST_AUTO_TEST_CASE( simple_c_ucc ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 1);
     BOOST_CHECK_EQUAL (report.processes(), 6);
@@ -209,7 +274,7 @@ BOOST_AUTO_TEST_CASE( simple_c_lbr ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 1);
     BOOST_CHECK_EQUAL (report.processes(), 6);
@@ -248,7 +313,7 @@ BOOST_AUTO_TEST_CASE( inheritance_ucc ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 1);
     BOOST_CHECK_EQUAL (report.processes(), 7);
@@ -284,7 +349,7 @@ BOOST_AUTO_TEST_CASE( inheritance_lbr ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 1);
     BOOST_CHECK_EQUAL (report.processes(), 6);
@@ -320,7 +385,7 @@ BOOST_AUTO_TEST_CASE( deep_ucc ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 5);
     BOOST_CHECK_EQUAL (report.processes(), 7);
@@ -425,7 +490,7 @@ BOOST_AUTO_TEST_CASE( deep_lbr ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 5);
     BOOST_CHECK_EQUAL (report.processes(), 6);
@@ -530,7 +595,7 @@ BOOST_AUTO_TEST_CASE( area_ucc ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 2);
     BOOST_CHECK_EQUAL (report.processes(), 8);
@@ -585,7 +650,7 @@ BOOST_AUTO_TEST_CASE( area_lbr ){
     gooda::afdo_data data;
 
     //Convert the Gooda report to AFDO
-    gooda::convert_to_afdo(report, data, options.vm);
+    gooda::convert_to_afdo(report, data, gooda::make_config(options.vm));
 
     BOOST_CHECK_EQUAL (data.functions.size(), 2);
     BOOST_CHECK_EQUAL (report.processes(), 7);
@@ -630,4 +695,1224 @@ BOOST_AUTO_TEST_CASE( area_lbr ){
 }
 
 
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(FlatHashMapSuite)
+
+//The identity hash collides on the low bits, the probing must still find every key
+struct identity_hash {
+    std::size_t operator()(uint64_t key) const {
+        return key;
+    }
+};
+
+BOOST_AUTO_TEST_CASE( flat_hash_map_insert_find ){
+    gooda::flat_hash_map<uint64_t, uint64_t, identity_hash> map;
+
+    BOOST_CHECK(map.find(1) == nullptr);
+    BOOST_CHECK_EQUAL(map.size(), 0);
+
+    //Enough entries to grow the table several times
+    for(uint64_t i = 0; i < 10000; ++i){
+        map[i << 12] = i;
+    }
+
+    BOOST_CHECK_EQUAL(map.size(), 10000);
+
+    for(uint64_t i = 0; i < 10000; ++i){
+        auto* value = map.find(i << 12);
+
+        BOOST_REQUIRE(value != nullptr);
+        BOOST_CHECK_EQUAL(*value, i);
+    }
+
+    BOOST_CHECK(map.find(1) == nullptr);
+    BOOST_CHECK(map.find(10000ULL << 12) == nullptr);
+
+    //An existing key is not inserted again
+    map[0] += 5;
+    BOOST_CHECK_EQUAL(map.size(), 10000);
+    BOOST_CHECK_EQUAL(*map.find(0), 5);
+}
+
+BOOST_AUTO_TEST_CASE( flat_hash_map_for_each_clear ){
+    gooda::flat_hash_map<std::string, int> map;
+
+    map["a"] = 1;
+    map["b"] = 2;
+    map["c"] = 3;
+
+    int sum = 0;
+    std::size_t entries = 0;
+    map.for_each([&](const std::string&, int& value){
+        sum += value;
+        ++entries;
+    });
+
+    BOOST_CHECK_EQUAL(sum, 6);
+    BOOST_CHECK_EQUAL(entries, 3);
+
+    const auto& const_map = map;
+    BOOST_REQUIRE(const_map.find("b") != nullptr);
+    BOOST_CHECK_EQUAL(*const_map.find("b"), 2);
+
+    map.clear();
+
+    BOOST_CHECK_EQUAL(map.size(), 0);
+    BOOST_CHECK(map.find("a") == nullptr);
+
+    map["a"] = 4;
+    BOOST_CHECK_EQUAL(*map.find("a"), 4);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(SymbolCacheSuite)
+
+BOOST_AUTO_TEST_CASE( build_id_notes ){
+    //The test executable is linked with a build-id, the executables of the cases are not
+    auto id = gooda::build_id("/proc/self/exe");
+
+    BOOST_CHECK_EQUAL(id.size(), 40);
+    BOOST_CHECK_EQUAL(id.find_first_not_of("0123456789abcdef"), std::string::npos);
+
+    BOOST_CHECK_EQUAL(gooda::build_id("tests/cases/deep/deep"), "");
+    BOOST_CHECK_EQUAL(gooda::build_id("tests/UnitTest.cpp"), "");
+    BOOST_CHECK_EQUAL(gooda::build_id("tests/cases/missing"), "");
+}
+
+BOOST_AUTO_TEST_CASE( symbol_cache_reload ){
+    temporary_directory directory;
+
+    {
+        gooda::symbol_cache cache(directory.path);
+
+        cache.store_frames("abcd", {{"0x400750", {{"main", "deep.cpp:6"}, {"compute<10>", "deep_sum.hpp:6 (discriminator 2)"}}}});
+        cache.store_names("abcd", {{"400750", "main"}});
+    }
+
+    gooda::symbol_cache cache(directory.path);
+
+    std::vector<std::string> addresses = {"0x400750", "0x400760"};
+    std::vector<gooda::symbol_frames> hits;
+    std::vector<std::string> misses;
+
+    cache.lookup_frames("abcd", addresses.begin(), addresses.end(), hits, misses);
+
+    BOOST_REQUIRE_EQUAL(hits.size(), 1);
+    BOOST_CHECK_EQUAL(hits[0].first, "0x400750");
+    BOOST_REQUIRE_EQUAL(hits[0].second.size(), 2);
+    BOOST_CHECK_EQUAL(hits[0].second[1].function, "compute<10>");
+    BOOST_CHECK_EQUAL(hits[0].second[1].location, "deep_sum.hpp:6 (discriminator 2)");
+
+    BOOST_REQUIRE_EQUAL(misses.size(), 1);
+    BOOST_CHECK_EQUAL(misses[0], "0x400760");
+
+    //The addresses are compared by value, not by spelling
+    std::vector<gooda::symbol_name> names;
+    BOOST_CHECK(cache.lookup_names("abcd", {"0x400750"}, names));
+    BOOST_REQUIRE_EQUAL(names.size(), 1);
+    BOOST_CHECK_EQUAL(names[0].second, "main");
+
+    BOOST_CHECK(!cache.lookup_names("abcd", {"0x400750", "0x400760"}, names));
+    BOOST_CHECK(names.empty());
+}
+
+BOOST_AUTO_TEST_CASE( symbol_cache_invalid_records ){
+    temporary_directory directory;
+
+    {
+        gooda::symbol_cache cache(directory.path);
+
+        cache.store_names("abcd", {{"0x10", "first"}, {"0x20", "second"}});
+    }
+
+    //Corrupt the first record and tear a third one
+    auto file = directory.path + "/abcd";
+    auto content = file_content(file);
+
+    content[content.find("first")] = 'F';
+    content += "F\t0x30\tthi";
+
+    {
+        std::ofstream stream(file, std::ios::out | std::ios::binary | std::ios::trunc);
+        stream << content;
+    }
+
+    {
+        gooda::symbol_cache cache(directory.path);
+
+        std::vector<gooda::symbol_name> names;
+        BOOST_CHECK(!cache.lookup_names("abcd", {"0x10"}, names));
+        BOOST_CHECK(cache.lookup_names("abcd", {"0x20"}, names));
+        BOOST_CHECK(!cache.lookup_names("abcd", {"0x30"}, names));
+
+        //The next record is appended after the torn one
+        cache.store_names("abcd", {{"0x40", "fourth"}});
+    }
+
+    gooda::symbol_cache cache(directory.path);
+
+    std::vector<gooda::symbol_name> names;
+    BOOST_CHECK(cache.lookup_names("abcd", {"0x20", "0x40"}, names));
+    BOOST_CHECK(!cache.lookup_names("abcd", {"0x10"}, names));
+}
+
+BOOST_AUTO_TEST_CASE( symbol_cache_memory_only ){
+    gooda::symbol_cache cache("");
+
+    cache.store_names("abcd", {{"0x10", "first"}});
+
+    std::vector<gooda::symbol_name> names;
+    BOOST_CHECK(cache.lookup_names("abcd", {"0x10"}, names));
+
+    //Nothing is written to the current directory
+    BOOST_CHECK(!gooda::exists("abcd"));
+}
+
+BOOST_AUTO_TEST_CASE( symbol_cache_capacity ){
+    temporary_directory directory;
+
+    gooda::symbol_cache memory("", 2);
+    gooda::symbol_cache persistent(directory.path, 2);
+
+    for(auto id : {"a", "b", "c"}){
+        memory.store_names(id, {{"0x10", id}});
+        persistent.store_names(id, {{"0x10", id}});
+    }
+
+    //The least recently used build-id is released from memory, but not from the directory
+    std::vector<gooda::symbol_name> names;
+    BOOST_CHECK(!memory.lookup_names("a", {"0x10"}, names));
+    BOOST_CHECK(memory.lookup_names("c", {"0x10"}, names));
+
+    BOOST_CHECK(persistent.lookup_names("a", {"0x10"}, names));
+    BOOST_CHECK(persistent.lookup_names("b", {"0x10"}, names));
+}
+
+BOOST_AUTO_TEST_CASE( addr2line_pool_capacity ){
+    gooda::addr2line_pool pool(1);
+
+    std::vector<std::string> addresses = {"0x400750"};
+    std::size_t answers = 0;
+
+    auto callback = [&answers](const std::string&, std::vector<gooda::addr2line_frame>& frames){
+        answers += !frames.empty();
+    };
+
+    pool.query("addr2line", "tests/cases/deep/deep", addresses.begin(), addresses.end(), callback);
+    BOOST_CHECK_EQUAL(pool.idle_processes("addr2line", "tests/cases/deep/deep"), 1);
+
+    //The process of the least recently queried executable is terminated
+    pool.query("addr2line", "tests/cases/simple/simple", addresses.begin(), addresses.end(), callback);
+    BOOST_CHECK_EQUAL(pool.idle_processes("addr2line", "tests/cases/deep/deep"), 0);
+    BOOST_CHECK_EQUAL(pool.idle_processes("addr2line", "tests/cases/simple/simple"), 1);
+
+    BOOST_CHECK_EQUAL(answers, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(WorkingSetSuite)
+
+BOOST_AUTO_TEST_CASE( working_set_uniform ){
+    //1000 instructions executed once, each bucket holds 1000 / 129 = 7 more instructions
+    std::vector<uint64_t> counts(1000, 1);
+
+    gooda::afdo_data data;
+    gooda::compute_working_set(counts, 1000, data, 1);
+
+    for(std::size_t i = 0; i < gooda::WS_SIZE; ++i){
+        BOOST_CHECK_EQUAL(data.working_set[i].num_counter, 7 * (i + 1));
+        BOOST_CHECK_EQUAL(data.working_set[i].min_counter, 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( working_set_hot_instruction ){
+    //A single instruction holds half the count, it is the minimum counter of the first half of the buckets
+    std::vector<uint64_t> counts(1000, 1);
+    counts[500] = 1000;
+
+    gooda::afdo_data data;
+    gooda::compute_working_set(counts, 1999, data, 1);
+
+    //Each bucket holds 1999 / 129 = 15, the hot instruction reaches 990 (66 buckets)
+    for(std::size_t i = 0; i < 66; ++i){
+        BOOST_CHECK_EQUAL(data.working_set[i].min_counter, 1000);
+    }
+
+    for(std::size_t i = 66; i < gooda::WS_SIZE; ++i){
+        BOOST_CHECK_EQUAL(data.working_set[i].min_counter, 1);
+        BOOST_CHECK(data.working_set[i].num_counter > data.working_set[i - 1].num_counter);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( working_set_histogram ){
+    //The histogram and the parallel ranking of the counts give the same buckets
+    std::vector<uint64_t> counts;
+    std::map<uint64_t, uint64_t> runs;
+    uint64_t total_count = 0;
+
+    uint64_t seed = 42;
+    for(std::size_t i = 0; i < 50000; ++i){
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        uint64_t count = (seed >> 33) % 1000;
+
+        counts.push_back(count);
+        ++runs[count];
+        total_count += count;
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> histogram(runs.begin(), runs.end());
+
+    gooda::afdo_data sorted;
+    gooda::afdo_data parallel;
+    gooda::afdo_data from_histogram;
+
+    auto copy = counts;
+    gooda::compute_working_set(copy, total_count, sorted, 1);
+    gooda::compute_working_set(counts, total_count, parallel, 4);
+    gooda::compute_working_set(histogram, total_count, from_histogram);
+
+    for(std::size_t i = 0; i < gooda::WS_SIZE; ++i){
+        BOOST_CHECK_EQUAL(sorted.working_set[i].num_counter, parallel.working_set[i].num_counter);
+        BOOST_CHECK_EQUAL(sorted.working_set[i].min_counter, parallel.working_set[i].min_counter);
+        BOOST_CHECK_EQUAL(sorted.working_set[i].num_counter, from_histogram.working_set[i].num_counter);
+        BOOST_CHECK_EQUAL(sorted.working_set[i].min_counter, from_histogram.working_set[i].min_counter);
+
+        if(i > 0){
+            BOOST_CHECK(sorted.working_set[i].num_counter >= sorted.working_set[i - 1].num_counter);
+            BOOST_CHECK(sorted.working_set[i].min_counter <= sorted.working_set[i - 1].min_counter);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( working_set_stacks ){
+    gooda::afdo_data data;
+    data.functions.emplace_back();
+
+    gooda::afdo_stack stack;
+    stack.count = 10;
+    stack.num_inst = 3;
+    data.functions[0].stacks.push_back(stack);
+
+    //The instructions of a stack are never expanded
+    stack.count = 1ULL << 50;
+    stack.num_inst = 1ULL << 40;
+    data.functions[0].stacks.push_back(stack);
+
+    std::vector<std::pair<uint64_t, uint64_t>> histogram;
+    uint64_t total_count = 0;
+    gooda::collect_stack_counts(data, false, histogram, total_count);
+
+    std::sort(histogram.begin(), histogram.end());
+
+    //The remainder of the count is kept, the total is the sum of the counts of the stacks
+    std::vector<std::pair<uint64_t, uint64_t>> expected = {{3, 2}, {4, 1}, {1ULL << 10, 1ULL << 40}};
+    BOOST_CHECK(histogram == expected);
+    BOOST_CHECK_EQUAL(total_count, 10 + (1ULL << 50));
+
+    histogram.clear();
+    total_count = 0;
+    data.functions[0].stacks.pop_back();
+    gooda::collect_stack_counts(data, true, histogram, total_count);
+
+    //In LBR, each instruction has the count of its stack
+    expected = {{10, 3}};
+    BOOST_CHECK(histogram == expected);
+    BOOST_CHECK_EQUAL(total_count, 30);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(SelectionSuite)
+
+/*!
+ * \brief Return the names of the functions of a profile, in order.
+ */
+std::vector<std::string> function_names(const gooda::afdo_data& data){
+    std::vector<std::string> names;
+    for(auto& function : data.functions){
+        names.push_back(function.name);
+    }
+    return names;
+}
+
+BOOST_AUTO_TEST_CASE( select_top ){
+    auto report = gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets");
+
+    auto config = deep_config();
+    config.top = 3;
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, config);
+
+    std::vector<std::string> expected = {"_Z7computeILi4EEll", "_Z7computeILi1EEll", "_Z11compute_sumll.part.0"};
+    auto names = function_names(data);
+    BOOST_CHECK_EQUAL_COLLECTIONS(names.begin(), names.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE( select_coverage ){
+    auto report = gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets");
+
+    //compute<4> holds half of the cycles of the hotspot functions, compute<1> is needed to pass 60%
+    auto config = deep_config();
+    config.coverage = 0.5;
+
+    gooda::afdo_data half;
+    gooda::convert_to_afdo(report, half, config);
+
+    BOOST_CHECK_EQUAL(half.functions.size(), 1);
+
+    config.coverage = 0.6;
+
+    gooda::afdo_data more;
+    gooda::convert_to_afdo(report, more, config);
+
+    BOOST_CHECK_EQUAL(more.functions.size(), 2);
+
+    //Both limits apply, the tightest one wins
+    config.coverage = 1.0;
+    config.top = 4;
+
+    gooda::afdo_data both;
+    gooda::convert_to_afdo(report, both, config);
+
+    BOOST_CHECK_EQUAL(both.functions.size(), 4);
+}
+
+BOOST_AUTO_TEST_CASE( select_missing_views ){
+    temporary_directory directory;
+
+    //The hottest function has no assembly view, it does not take one of the slots
+    gooda::exec_command("cp -r tests/cases/deep/ucc/spreadsheets " + directory.path + " && rm " + directory.path + "/spreadsheets/asm/0_asm.csv");
+
+    auto report = gooda::read_spreadsheets(directory.path + "/spreadsheets");
+
+    auto config = deep_config();
+    config.top = 2;
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, config);
+
+    std::vector<std::string> expected = {"_Z7computeILi1EEll", "_Z11compute_sumll.part.0"};
+    auto names = function_names(data);
+    BOOST_CHECK_EQUAL_COLLECTIONS(names.begin(), names.end(), expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(AggregateSuite)
+
+BOOST_AUTO_TEST_CASE( aggregate_single ){
+    auto config = deep_config();
+
+    std::vector<gooda::gooda_report> reports;
+    reports.push_back(gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets"));
+
+    gooda::afdo_data expected;
+    gooda::convert_to_afdo(reports.front(), expected, config);
+
+    //A single report is not merged with itself
+    gooda::afdo_data data;
+    gooda::aggregate_to_afdo(reports, {}, data, config);
+
+    BOOST_REQUIRE_EQUAL(data.functions.size(), expected.functions.size());
+
+    for(std::size_t i = 0; i < data.functions.size(); ++i){
+        BOOST_CHECK_EQUAL(data.functions[i].name, expected.functions[i].name);
+        BOOST_CHECK_EQUAL(data.functions[i].total_count, expected.functions[i].total_count);
+        BOOST_CHECK_EQUAL(data.functions[i].stacks.size(), expected.functions[i].stacks.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( aggregate_weights ){
+    auto config = deep_config();
+
+    std::vector<gooda::gooda_report> reports;
+    reports.push_back(gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets"));
+    reports.push_back(gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets"));
+
+    gooda::afdo_data single;
+    gooda::convert_to_afdo(reports.front(), single, config);
+
+    gooda::afdo_data sum;
+    gooda::aggregate_to_afdo(reports, {}, sum, config);
+
+    gooda::afdo_data mean;
+    gooda::aggregate_to_afdo(reports, {0.25, 0.75}, mean, config);
+
+    BOOST_REQUIRE_EQUAL(sum.functions.size(), single.functions.size());
+    BOOST_REQUIRE_EQUAL(mean.functions.size(), single.functions.size());
+
+    for(std::size_t i = 0; i < single.functions.size(); ++i){
+        BOOST_CHECK_EQUAL(sum.functions[i].total_count, 2 * single.functions[i].total_count);
+        BOOST_CHECK_EQUAL(sum.functions[i].stacks.size(), single.functions[i].stacks.size());
+
+        //Each scaled count is truncated
+        BOOST_CHECK_LE(mean.functions[i].total_count, single.functions[i].total_count);
+        BOOST_CHECK_GE(mean.functions[i].total_count + 2, single.functions[i].total_count);
+    }
+
+    BOOST_CHECK_THROW(gooda::aggregate_to_afdo(reports, {1.0}, mean, config), gooda::gooda_exception);
+}
+
+BOOST_AUTO_TEST_CASE( aggregate_executables ){
+    temporary_directory directory;
+
+    //The main functions of two different executables with the same name
+    for(auto c : {"simple", "simple-c"}){
+        gooda::exec_command(std::string("mkdir ") + directory.path + "/" + c + " && cp -r tests/cases/" + c + "/ucc/spreadsheets " + directory.path + "/" + c
+            + " && sed -i 's|\"simple\", \"simple\"|\"" + c + "/simple\", \"simple\"|' " + directory.path + "/" + c + "/spreadsheets/function_hotspots.csv");
+    }
+
+    gooda::converter_config config;
+    config.auto_mode = true;
+    config.folder = "tests/cases/";
+
+    std::vector<gooda::gooda_report> reports;
+    reports.push_back(gooda::read_spreadsheets(directory.path + "/simple/spreadsheets"));
+    reports.push_back(gooda::read_spreadsheets(directory.path + "/simple-c/spreadsheets"));
+
+    gooda::afdo_data data;
+    gooda::aggregate_to_afdo(reports, {}, data, config);
+
+    BOOST_REQUIRE_EQUAL(data.functions.size(), 2);
+    BOOST_CHECK_EQUAL(data.functions[0].name, "main");
+    BOOST_CHECK_EQUAL(data.functions[1].name, "main");
+    BOOST_CHECK_EQUAL(data.functions[0].executable_file, "simple/simple");
+    BOOST_CHECK_EQUAL(data.functions[1].executable_file, "simple-c/simple");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(StreamSuite)
+
+/*!
+ * \brief Check that the streamed profile of the given spreadsheets is identical to the converted one.
+ */
+void check_stream(const std::string& test_case, const std::string& mode){
+    temporary_directory directory;
+
+    gooda::converter_config config;
+    config.auto_mode = true;
+    config.discriminators = true;
+    config.folder = "tests/cases/" + test_case + "/";
+
+    auto spreadsheets = "tests/cases/" + test_case + "/" + mode + "/spreadsheets";
+
+    auto report = gooda::read_spreadsheets(spreadsheets);
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, config);
+    gooda::generate_afdo(data, directory.path + "/converted.afdo", config);
+
+    gooda::stream_to_afdo(spreadsheets, directory.path + "/streamed.afdo", config);
+
+    auto converted = file_content(directory.path + "/converted.afdo");
+    auto streamed = file_content(directory.path + "/streamed.afdo");
+
+    BOOST_CHECK(!converted.empty());
+    BOOST_CHECK_MESSAGE(converted == streamed, "The streamed profile of " << test_case << "/" << mode << " differs");
+}
+
+BOOST_AUTO_TEST_CASE( stream_ucc ){
+    for(auto test_case : {"simple", "simple-c", "inheritance", "deep", "area"}){
+        check_stream(test_case, "ucc");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( stream_lbr ){
+    for(auto test_case : {"simple", "simple-c", "inheritance", "deep", "area"}){
+        check_stream(test_case, "lbr");
+    }
+}
+
+BOOST_AUTO_TEST_CASE( stream_spool ){
+    temporary_directory directory;
+
+    auto output = directory.path + "/fbdata.afdo";
+
+    {
+        std::ofstream stream(output + ".functions");
+        stream << "kept";
+    }
+
+    gooda::stream_to_afdo("tests/cases/deep/ucc/spreadsheets", output, deep_config());
+
+    //An existing file is not replaced by the spool and the spool is removed
+    BOOST_CHECK_EQUAL(file_content(output + ".functions"), "kept");
+    BOOST_CHECK_EQUAL(gooda::exec_command("test $(ls " + directory.path + " | wc -l) -eq 2"), 0);
+    BOOST_CHECK(!file_content(output).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(UpdateSuite)
+
+BOOST_AUTO_TEST_CASE( update_working_set ){
+    auto config = deep_config();
+
+    auto report = gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets");
+
+    gooda::afdo_data history;
+    gooda::convert_to_afdo(report, history, config);
+
+    gooda::afdo_data empty;
+    gooda::afdo_data fresh;
+    gooda::update_to_afdo(report, empty, 0.5, fresh, config);
+
+    //The capture and the previous profile have the same stacks, they are merged
+    gooda::afdo_data updated;
+    gooda::update_to_afdo(report, history, 1.0, updated, config);
+
+    BOOST_REQUIRE_EQUAL(updated.functions.size(), fresh.functions.size());
+
+    for(std::size_t i = 0; i < fresh.functions.size(); ++i){
+        BOOST_CHECK_EQUAL(updated.functions[i].total_count, 2 * fresh.functions[i].total_count);
+        BOOST_CHECK_EQUAL(updated.functions[i].stacks.size(), fresh.functions[i].stacks.size());
+    }
+
+    //The instructions of both profiles are counted once, as in the working set of the merged stacks
+    auto working_set = updated.working_set;
+    gooda::recompute_working_set(updated, false);
+
+    BOOST_REQUIRE_EQUAL(working_set.size(), updated.working_set.size());
+
+    for(std::size_t i = 0; i < working_set.size(); ++i){
+        BOOST_CHECK_EQUAL(working_set[i].num_counter, updated.working_set[i].num_counter);
+        BOOST_CHECK_EQUAL(working_set[i].min_counter, updated.working_set[i].min_counter);
+    }
+}
+
+/*!
+ * \brief Copy the spreadsheets of the deep case, with a second main function in a copy of the executable.
+ */
+std::string two_executables(const temporary_directory& directory){
+    auto spreadsheets = directory.path + "/spreadsheets";
+
+    gooda::exec_command("cp tests/cases/deep/deep " + directory.path + " && mkdir " + directory.path + "/copy && cp tests/cases/deep/deep " + directory.path + "/copy"
+        + " && cp -r tests/cases/deep/ucc/spreadsheets " + directory.path
+        + " && sed -i '/^\\[,4,4,/{p;s/^\\[,4,4,/[,5,5,/;s|\"deep\", \"deep\"|\"copy/deep\", \"deep\"|}' " + spreadsheets + "/function_hotspots.csv"
+        + " && cp " + spreadsheets + "/asm/4_asm.csv " + spreadsheets + "/asm/5_asm.csv");
+
+    return spreadsheets;
+}
+
+BOOST_AUTO_TEST_CASE( update_executables ){
+    temporary_directory directory;
+
+    auto report = gooda::read_spreadsheets(two_executables(directory));
+
+    //The working set of an update is estimated from the stacks
+    auto config = deep_config();
+    config.folder = directory.path + "/";
+    config.working_set = false;
+
+    gooda::afdo_data plain;
+    gooda::convert_to_afdo(report, plain, config);
+    gooda::generate_afdo(plain, directory.path + "/plain.afdo", config);
+
+    //The previous profile is read back, without the executables
+    gooda::afdo_data history;
+    gooda::read_afdo(directory.path + "/plain.afdo", history, config);
+
+    //Without the previous counts, the update is the plain conversion
+    gooda::afdo_data updated;
+    gooda::update_to_afdo(report, history, 0.0, updated, config);
+    gooda::generate_afdo(updated, directory.path + "/updated.afdo", config);
+
+    BOOST_CHECK(file_content(directory.path + "/plain.afdo") == file_content(directory.path + "/updated.afdo"));
+
+    std::size_t mains = 0;
+    for(auto& function : updated.functions){
+        mains += function.name == "main";
+    }
+
+    BOOST_CHECK_EQUAL(mains, 2);
+}
+
+BOOST_AUTO_TEST_CASE( update_decay ){
+    temporary_directory directory;
+
+    auto report = gooda::read_spreadsheets(two_executables(directory));
+
+    auto config = deep_config();
+    config.folder = directory.path + "/";
+
+    gooda::afdo_data fresh;
+    gooda::convert_to_afdo(report, fresh, config);
+    gooda::generate_afdo(fresh, directory.path + "/fresh.afdo", config);
+
+    gooda::afdo_data history;
+    gooda::read_afdo(directory.path + "/fresh.afdo", history, config);
+
+    gooda::afdo_data updated;
+    gooda::update_to_afdo(report, history, 0.3, updated, config);
+
+    //Each function, including each main function, is merged with its own decayed counts
+    BOOST_REQUIRE_EQUAL(updated.functions.size(), fresh.functions.size());
+
+    for(std::size_t i = 0; i < fresh.functions.size(); ++i){
+        auto& function = fresh.functions[i];
+
+        BOOST_CHECK_EQUAL(updated.functions[i].name, function.name);
+        BOOST_CHECK_EQUAL(updated.functions[i].total_count, function.total_count + static_cast<gcov_type>(function.total_count * 0.3));
+        BOOST_REQUIRE_EQUAL(updated.functions[i].stacks.size(), function.stacks.size());
+
+        for(std::size_t j = 0; j < function.stacks.size(); ++j){
+            BOOST_CHECK_EQUAL(updated.functions[i].stacks[j].count, function.stacks[j].count + static_cast<gcov_type>(function.stacks[j].count * 0.3));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(PerfSuite)
+
+/*!
+ * \brief The address of the _Z3absl function in tests/cases/deep/deep.
+ */
+const uint64_t ABSL_ADDRESS = 0x403910;
+
+/*!
+ * \brief Append a value to a record.
+ */
+template<typename T>
+void append(std::string& record, T value){
+    record.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+/*!
+ * \brief Append a record to the data section of a perf.data file.
+ */
+void add_record(std::string& records, uint32_t type, uint16_t misc, const std::string& body){
+    perf_event_header header;
+    header.type = type;
+    header.misc = misc;
+    header.size = sizeof(header) + body.size();
+
+    records.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    records += body;
+}
+
+/*!
+ * \brief Append a user sample of the process 100, with IP, TID, TIME and PERIOD.
+ */
+void add_sample(std::string& records, uint64_t ip, uint64_t time, uint64_t period){
+    std::string body;
+    append<uint64_t>(body, ip);
+    append<uint32_t>(body, 100);
+    append<uint32_t>(body, 100);
+    append<uint64_t>(body, time);
+    append<uint64_t>(body, period);
+
+    add_record(records, PERF_RECORD_SAMPLE, PERF_RECORD_MISC_USER, body);
+}
+
+/*!
+ * \brief Append the sample_id fields of a record of the process 100: TID and TIME.
+ */
+void add_sample_id(std::string& body, uint64_t time){
+    append<uint32_t>(body, 100);
+    append<uint32_t>(body, 100);
+    append<uint64_t>(body, time);
+}
+
+/*!
+ * \brief Append the executable mapping of tests/cases/deep/deep in the process 100.
+ */
+void add_mapping(std::string& records, uint64_t time){
+    std::string body;
+    append<uint32_t>(body, 100);
+    append<uint32_t>(body, 100);
+    append<uint64_t>(body, 0x400000);
+    append<uint64_t>(body, 0x5000);
+    append<uint64_t>(body, 0);
+    body.append(24, '\0');
+    append<uint32_t>(body, 5);
+    append<uint32_t>(body, 2);
+    body += "tests/cases/deep/deep";
+    body.append(8 - body.size() % 8, '\0');
+    add_sample_id(body, time);
+
+    add_record(records, PERF_RECORD_MMAP2, 0, body);
+}
+
+/*!
+ * \brief Append the exec of a new program in the process 100.
+ */
+void add_exec(std::string& records, uint64_t time){
+    std::string body;
+    append<uint32_t>(body, 100);
+    append<uint32_t>(body, 100);
+    body.append("other", 5);
+    body.append(11, '\0');
+    add_sample_id(body, time);
+
+    add_record(records, PERF_RECORD_COMM, PERF_RECORD_MISC_COMM_EXEC, body);
+}
+
+/*!
+ * \brief Write a perf.data file with a single cycles event and the given records.
+ */
+void write_perf_data(const std::string& file, const std::string& records, uint64_t ids_size = sizeof(uint64_t)){
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.sample_type = PERF_SAMPLE_IP | PERF_SAMPLE_TID | PERF_SAMPLE_TIME | PERF_SAMPLE_PERIOD;
+    attr.sample_id_all = 1;
+
+    uint64_t header_size = 104;
+    uint64_t attrs_offset = header_size;
+    uint64_t attrs_size = sizeof(attr) + 2 * sizeof(uint64_t);
+    uint64_t ids_offset = attrs_offset + attrs_size;
+    uint64_t data_offset = ids_offset + sizeof(uint64_t);
+
+    std::string content;
+    append<uint64_t>(content, 0x32454c4946524550ULL);
+    append<uint64_t>(content, header_size);
+    append<uint64_t>(content, attrs_size);
+    append<uint64_t>(content, attrs_offset);
+    append<uint64_t>(content, attrs_size);
+    append<uint64_t>(content, data_offset);
+    append<uint64_t>(content, records.size());
+    content.append(6 * sizeof(uint64_t), '\0');
+
+    append(content, attr);
+    append<uint64_t>(content, ids_offset);
+    append<uint64_t>(content, ids_size);
+    append<uint64_t>(content, 42);
+
+    content += records;
+
+    std::ofstream stream(file, std::ios::out | std::ios::binary);
+    stream << content;
+}
+
+/*!
+ * \brief Return the sampled function with the given name, nullptr if it has no samples.
+ */
+const gooda::perf_function* find_function(const gooda::perf_profile& profile, const std::string& name){
+    for(auto& function : profile.functions){
+        if(function.name == name){
+            return &function;
+        }
+    }
+
+    return nullptr;
+}
+
+BOOST_AUTO_TEST_CASE( perf_period ){
+    temporary_directory directory;
+
+    std::string records;
+    add_mapping(records, 1);
+    add_sample(records, ABSL_ADDRESS, 2, 3);
+    add_sample(records, ABSL_ADDRESS + 2, 3, 5);
+    add_sample(records, ABSL_ADDRESS, 4, 2);
+
+    write_perf_data(directory.path + "/perf.data", records);
+
+    auto profile = gooda::read_perf_data(directory.path + "/perf.data", gooda::converter_config());
+
+    BOOST_CHECK_EQUAL(profile.samples, 3);
+    BOOST_CHECK_EQUAL(profile.unresolved, 0);
+
+    //Each sample counts for its period
+    auto function = find_function(profile, "_Z3absl");
+    BOOST_REQUIRE(function);
+    BOOST_REQUIRE_EQUAL(function->samples.size(), 2);
+    BOOST_CHECK_EQUAL(function->samples[0].first, ABSL_ADDRESS);
+    BOOST_CHECK_EQUAL(function->samples[0].second, 5);
+    BOOST_CHECK_EQUAL(function->samples[1].first, ABSL_ADDRESS + 2);
+    BOOST_CHECK_EQUAL(function->samples[1].second, 5);
+}
+
+BOOST_AUTO_TEST_CASE( perf_time_order ){
+    temporary_directory directory;
+
+    //The buffers of two CPUs: the first sample is written before the mapping and the second after the exec
+    std::string records;
+    add_sample(records, ABSL_ADDRESS, 5, 3);
+    add_mapping(records, 1);
+    add_exec(records, 10);
+    add_sample(records, ABSL_ADDRESS, 6, 5);
+    add_sample(records, ABSL_ADDRESS, 11, 7);
+
+    write_perf_data(directory.path + "/perf.data", records);
+
+    auto profile = gooda::read_perf_data(directory.path + "/perf.data", gooda::converter_config());
+
+    //Only the sample after the exec is not in the mapping
+    BOOST_CHECK_EQUAL(profile.samples, 3);
+    BOOST_CHECK_EQUAL(profile.unresolved, 1);
+
+    auto function = find_function(profile, "_Z3absl");
+    BOOST_REQUIRE(function);
+    BOOST_REQUIRE_EQUAL(function->samples.size(), 1);
+    BOOST_CHECK_EQUAL(function->samples[0].second, 8);
+}
+
+BOOST_AUTO_TEST_CASE( perf_invalid_sections ){
+    temporary_directory directory;
+
+    std::string records;
+    add_mapping(records, 1);
+    add_sample(records, ABSL_ADDRESS, 2, 3);
+
+    //The identifiers are larger than the file
+    write_perf_data(directory.path + "/perf.data", records, 1ULL << 60);
+
+    BOOST_CHECK_THROW(gooda::read_perf_data(directory.path + "/perf.data", gooda::converter_config()), gooda::gooda_exception);
+
+    //The data section is truncated
+    write_perf_data(directory.path + "/perf.data", records);
+    gooda::exec_command("truncate -s -8 " + directory.path + "/perf.data");
+
+    BOOST_CHECK_THROW(gooda::read_perf_data(directory.path + "/perf.data", gooda::converter_config()), gooda::gooda_exception);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(ResultCacheSuite)
+
+BOOST_AUTO_TEST_CASE( result_cache_invalidation ){
+    temporary_directory directory;
+
+    gooda::exec_command("cp tests/cases/deep/deep " + directory.path + " && cp -r tests/cases/deep/ucc/spreadsheets " + directory.path);
+    gooda::exec_command("printf '#!/bin/sh\\nexec addr2line \"$@\"\\n' > " + directory.path + "/tool && chmod +x " + directory.path + "/tool");
+
+    gooda::converter_config config;
+    config.auto_mode = true;
+    config.folder = directory.path + "/";
+    config.addr2line = directory.path + "/tool";
+
+    auto spreadsheets = directory.path + "/spreadsheets";
+    auto output = directory.path + "/deep.afdo";
+
+    gooda::result_cache cache(directory.path + "/cache");
+
+    auto key = cache.key(spreadsheets, config);
+    BOOST_CHECK(!cache.fetch(key, config, output));
+
+    auto report = gooda::read_spreadsheets(spreadsheets);
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, config);
+    gooda::generate_afdo(data, output, config);
+    cache.store(key, data, config, output);
+
+    auto expected = file_content(output);
+    std::remove(output.c_str());
+
+    //The same spreadsheets and options give the same profile
+    BOOST_CHECK_EQUAL(cache.key(spreadsheets, config), key);
+    BOOST_CHECK(cache.fetch(key, config, output));
+    BOOST_CHECK(file_content(output) == expected);
+
+    //The options and the tools change the key
+    auto other = config;
+    other.top = 2;
+    BOOST_CHECK(cache.key(spreadsheets, other) != key);
+
+    gooda::exec_command("echo '#' >> " + directory.path + "/tool");
+    BOOST_CHECK(cache.key(spreadsheets, config) != key);
+
+    //A rebuilt executable does not match the cached profile
+    gooda::exec_command("echo >> " + directory.path + "/deep");
+    BOOST_CHECK(!cache.fetch(key, config, output));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(SplitSuite)
+
+/*!
+ * \brief Copy the spreadsheets of the deep case, with other module and process columns for compute_sum and its part.
+ */
+std::string split_spreadsheets(const temporary_directory& directory, const std::string& sum, const std::string& part){
+    auto spreadsheets = directory.path + "/spreadsheets";
+
+    gooda::exec_command("cp -r tests/cases/deep/ucc/spreadsheets " + directory.path
+        + " && sed -i -e '/^\\[,2,2,/s|\"deep\", \"deep\"|" + sum + "|' -e '/^\\[,3,3,/s|\"deep\", \"deep\"|" + part + "|' "
+        + spreadsheets + "/function_hotspots.csv");
+
+    return spreadsheets;
+}
+
+/*!
+ * \brief Return the total count of each function of a profile, by name.
+ */
+std::map<std::string, gcov_type> function_counts(const gooda::afdo_data& data){
+    std::map<std::string, gcov_type> counts;
+    for(auto& function : data.functions){
+        counts[function.name] = function.total_count;
+    }
+    return counts;
+}
+
+BOOST_AUTO_TEST_CASE( split_by_process ){
+    temporary_directory directory;
+
+    auto config = deep_config();
+
+    gooda::afdo_data whole;
+    gooda::convert_to_afdo(gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets"), whole, config);
+
+    auto expected = function_counts(whole);
+
+    auto report = gooda::read_spreadsheets(split_spreadsheets(directory, "\"deep\", \"a/b\"", "\"deep\", \"a_b\""));
+
+    std::map<std::string, gooda::afdo_data> profiles;
+    gooda::convert_to_afdo_by_process(report, profiles, config);
+
+    BOOST_REQUIRE_EQUAL(profiles.size(), 3);
+    BOOST_REQUIRE_EQUAL(profiles["a/b"].functions.size(), 1);
+    BOOST_REQUIRE_EQUAL(profiles["a_b"].functions.size(), 1);
+    BOOST_CHECK_EQUAL(profiles["a/b"].functions[0].name, "_Z11compute_sumll");
+    BOOST_CHECK_EQUAL(profiles["a_b"].functions[0].name, "_Z11compute_sumll.part.0");
+    BOOST_CHECK_EQUAL(profiles["deep"].functions.size(), 3);
+
+    //Each function has the same counts as in the profile of all the processes
+    for(auto& profile : profiles){
+        for(auto& function : function_counts(profile.second)){
+            BOOST_CHECK_EQUAL(function.second, expected[function.first]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( split_by_module ){
+    temporary_directory directory;
+
+    //compute_sum and its part come from a copy of the executable
+    gooda::exec_command("cp tests/cases/deep/deep " + directory.path + " && mkdir " + directory.path + "/copy && cp tests/cases/deep/deep " + directory.path + "/copy");
+
+    auto config = deep_config();
+
+    gooda::afdo_data whole;
+    gooda::convert_to_afdo(gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets"), whole, config);
+
+    auto expected = function_counts(whole);
+
+    auto report = gooda::read_spreadsheets(split_spreadsheets(directory, "\"copy/deep\", \"deep\"", "\"copy/deep\", \"deep\""));
+
+    config.folder = directory.path + "/";
+    config.working_set = true;
+
+    std::map<std::string, gooda::afdo_data> profiles;
+    gooda::convert_to_afdo_by_module(report, profiles, config);
+
+    BOOST_REQUIRE_EQUAL(profiles.size(), 2);
+    BOOST_CHECK_EQUAL(profiles["deep"].functions.size(), 3);
+    BOOST_REQUIRE_EQUAL(profiles["copy/deep"].functions.size(), 2);
+
+    for(auto& profile : profiles){
+        for(auto& function : profile.second.functions){
+            BOOST_CHECK_EQUAL(function.executable_file, profile.first);
+            BOOST_CHECK_EQUAL(function.total_count, expected[function.name]);
+        }
+
+        //Each module has its own working set
+        BOOST_CHECK(profile.second.working_set[gooda::WS_SIZE - 1].num_counter > 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( split_outputs ){
+    std::vector<std::string> partitions = {"a/b", "a_b", "", "unknown", "deep"};
+
+    //The partitions whose safe names collide have distinct files
+    auto files = gooda::partition_outputs("out/fbdata.afdo", partitions);
+
+    std::vector<std::string> expected = {"out/fbdata.a_b.afdo", "out/fbdata.a_b-2.afdo", "out/fbdata.unknown.afdo", "out/fbdata.unknown-2.afdo", "out/fbdata.deep.afdo"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(files.begin(), files.end(), expected.begin(), expected.end());
+
+    //The extension is only searched in the file name
+    BOOST_CHECK_EQUAL(gooda::partition_output("out.d/fbdata", "a b"), "out.d/fbdata.a_b");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(ServerSuite)
+
+/*!
+ * \brief Connect to the server.
+ */
+int connect_server(const std::string& socket_path){
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    BOOST_REQUIRE(fd != -1);
+    BOOST_REQUIRE(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0);
+
+    return fd;
+}
+
+/*!
+ * \brief Read the response of the server, until it closes the connection.
+ */
+std::string read_response(int fd){
+    std::string response;
+
+    char buffer[256];
+    ssize_t count;
+    while((count = read(fd, buffer, sizeof(buffer))) > 0){
+        response.append(buffer, count);
+    }
+
+    close(fd);
+
+    return response;
+}
+
+/*!
+ * \brief Send a request to the server and return its response.
+ */
+std::string send_request(const std::string& socket_path, const std::string& request){
+    int fd = connect_server(socket_path);
+    BOOST_REQUIRE(write(fd, request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+    return read_response(fd);
+}
+
+BOOST_AUTO_TEST_CASE( serve_requests ){
+    temporary_directory directory;
+
+    auto socket_path = directory.path + "/converter.sock";
+    auto cwd = gooda::current_directory();
+
+    //A single worker, held by the silent client until its timeout
+    gooda::converter_config config;
+    config.jobs = 1;
+
+    std::thread server([&]{ gooda::serve(socket_path, config); });
+
+    while(!gooda::exists(socket_path)){
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    int silent = connect_server(socket_path);
+
+    //The request is converted like the command line
+    auto output = directory.path + "/deep.afdo";
+    auto response = send_request(socket_path, "--auto\t--folder=" + cwd + "/tests/cases/deep/\t-o\t" + output + "\t" + cwd + "/tests/cases/deep/ucc/spreadsheets\n");
+    BOOST_CHECK_EQUAL(response.substr(0, 3), "OK ");
+
+    auto report = gooda::read_spreadsheets("tests/cases/deep/ucc/spreadsheets");
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, deep_config());
+    gooda::generate_afdo(data, directory.path + "/expected.afdo", deep_config());
+
+    BOOST_CHECK(file_content(output) == file_content(directory.path + "/expected.afdo"));
+
+    //The silent client has been answered once its time was up
+    BOOST_CHECK_EQUAL(read_response(silent).substr(0, 6), "ERROR ");
+
+    //The paths of a request are not relative to the server
+    response = send_request(socket_path, "--auto\t-o\tdeep.afdo\t" + cwd + "/tests/cases/deep/ucc/spreadsheets\n");
+    BOOST_CHECK_EQUAL(response.substr(0, 6), "ERROR ");
+    BOOST_CHECK(!gooda::exists("deep.afdo"));
+
+    response = send_request(socket_path, "--stream\t-o\t" + output + "\t" + cwd + "/tests/cases/deep/ucc/spreadsheets\n");
+    BOOST_CHECK_EQUAL(response.substr(0, 6), "ERROR ");
+
+    //The server stops on SIGTERM and removes its socket
+    kill(getpid(), SIGTERM);
+    server.join();
+
+    BOOST_CHECK(!gooda::exists(socket_path));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(WatcherSuite)
+
+/*!
+ * \brief Wait for a file to exist.
+ * \return true if the file exists before the timeout, false otherwise.
+ */
+bool wait_for(const std::string& file, std::chrono::seconds timeout){
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    while(!gooda::exists(file)){
+        if(std::chrono::steady_clock::now() > deadline){
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return true;
+}
+
+BOOST_AUTO_TEST_CASE( watch_spreadsheets ){
+    temporary_directory directory;
+
+    auto spreadsheets = "tests/cases/deep/ucc/spreadsheets";
+    auto watched = directory.path + "/watched";
+    auto output = directory.path + "/watch.afdo";
+
+    BOOST_REQUIRE(gooda::exec_command("mkdir " + watched + " " + directory.path + "/staging") == 0);
+
+    //A spreadsheets directory present before the watch is converted at once
+    BOOST_REQUIRE(gooda::exec_command(std::string("cp -r ") + spreadsheets + " " + watched + "/early") == 0);
+
+    auto config = deep_config();
+
+    std::thread watcher([&]{ gooda::watch(watched, output, config); });
+
+    BOOST_REQUIRE(wait_for(gooda::partition_output(output, "early"), std::chrono::seconds(30)));
+
+    auto report = gooda::read_spreadsheets(spreadsheets);
+
+    gooda::afdo_data data;
+    gooda::convert_to_afdo(report, data, config);
+    gooda::generate_afdo(data, directory.path + "/expected.afdo", config);
+
+    BOOST_CHECK(file_content(gooda::partition_output(output, "early")) == file_content(directory.path + "/expected.afdo"));
+
+    //A directory whose last assembly view is never written is converted after the quiet period
+    auto quiet_start = std::chrono::steady_clock::now();
+
+    BOOST_REQUIRE(gooda::exec_command(std::string("cp -r ") + spreadsheets + " " + directory.path + "/staging/quiet") == 0);
+    BOOST_REQUIRE(gooda::exec_command("rm " + directory.path + "/staging/quiet/asm/4_asm.csv") == 0);
+    BOOST_REQUIRE(gooda::exec_command("mv " + directory.path + "/staging/quiet " + watched + "/quiet") == 0);
+
+    //A directory written file by file is converted once its last assembly view is complete
+    auto progressive = watched + "/progressive";
+
+    BOOST_REQUIRE(gooda::exec_command("mkdir -p " + progressive + "/asm") == 0);
+    BOOST_REQUIRE(gooda::exec_command(std::string("cp ") + spreadsheets + "/*.csv " + spreadsheets + "/*.txt " + progressive) == 0);
+
+    for(std::size_t i = 0; i < 4; ++i){
+        BOOST_REQUIRE(gooda::exec_command(std::string("cp ") + spreadsheets + "/asm/" + std::to_string(i) + "_asm.csv " + progressive + "/asm") == 0);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    BOOST_CHECK(!gooda::exists(gooda::partition_output(output, "progressive")));
+
+    BOOST_REQUIRE(gooda::exec_command(std::string("cp ") + spreadsheets + "/asm/4_asm.csv " + progressive + "/asm") == 0);
+
+    //Well before the quiet period
+    BOOST_CHECK(wait_for(gooda::partition_output(output, "progressive"), std::chrono::seconds(5)));
+    BOOST_CHECK(!gooda::exists(gooda::partition_output(output, "quiet")));
+
+    BOOST_REQUIRE(wait_for(gooda::partition_output(output, "quiet"), std::chrono::seconds(30)));
+    BOOST_CHECK(std::chrono::steady_clock::now() - quiet_start >= std::chrono::seconds(9));
+
+    //The function without assembly view has no samples
+    gooda::afdo_data quiet;
+    gooda::read_afdo(gooda::partition_output(output, "quiet"), quiet, config);
+
+    BOOST_CHECK(quiet.functions.size() < data.functions.size());
+
+    kill(getpid(), SIGTERM);
+    watcher.join();
+}
+
 BOOST_AUTO_TEST_SUITE_END()